@@ -22,13 +22,25 @@ extern "C" {
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdlib.h>
 
 #define MHASH_FAILED 1
 #define MHASH_OK 0
+#define MHASH_PENDING 2
 #ifndef MHASH_MAX_HASHES
 #define MHASH_MAX_HASHES 16
 #endif
 
+#ifndef MHASH_BATCH
+#define MHASH_BATCH 16
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MHASH_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define MHASH_PREFETCH(p) ((void)(p))
+#endif
+
 #ifndef MHASH_UINT
 //#define MHASH_UINT uint16_t
 #define MHASH_UINT uint64_t
@@ -62,48 +74,249 @@ static inline MHASH_UINT mhash__concat(mhash_func hash_func, MHASH_UINT num_hash
     return combined;
 }
 
-static inline int mhash_init(MHash *ph,
+// Where the placement routines read key i from: strings[i], or blob + offsets[i] when
+// strings is NULL. Maps with their own key types or slot reduction (MHASH_DEFINE_MAP,
+// mhash_dispatch.h) set slot instead, which returns the slot of key i for the given hash
+// count and table size, reading its keys through context.
+typedef struct MHashKeySource MHashKeySource;
+struct MHashKeySource {
+    const void **strings;
+    const char *blob;
+    const uint32_t *offsets;
+    size_t (*slot)(const MHashKeySource *keys, size_t i, MHASH_UINT num_hashes, size_t table_size);
+    const void *context;
+};
+
+static inline const void *mhash__key(const MHashKeySource *keys, size_t i) {
+    return keys->strings ? keys->strings[i] : keys->blob + keys->offsets[i];
+}
+
+static inline void mhash__setup(MHash *ph,
                         MHASH_INDEX_UINT *table,
                         size_t table_size,
-                        const void **strings,
                         size_t count,
-                        mhash_func hash_func) {
-    if (!ph || !table || !strings || table_size == 0)
-        return MHASH_FAILED;
+                        mhash_func hash_func,
+                        MHASH_UINT num_hashes) {
     ph->table      = table;
     ph->table_size = table_size;
     ph->count      = count;
     ph->hash_func  = hash_func;
-    ph->num_hashes = 0;
+    ph->num_hashes = num_hashes;
+}
 
+static inline size_t mhash__worst_case(size_t count) {
     size_t worst_case = MHASH_MAX_HASHES;
-
 #ifndef MHASH_NO_WORST_CASE
     if (worst_case > count) worst_case = count;
+#else
+    (void)count;
 #endif
+    return worst_case;
+}
+
+// Places keys [begin, end) with ph->num_hashes hashes into a table where they are not yet
+// placed. Returns the first key whose slot is taken, or end if all of them were placed.
+static inline size_t mhash__place(const MHash *ph, const MHashKeySource *keys, size_t begin, size_t end) {
+    MHASH_INDEX_UINT *table = ph->table;
+    const MHASH_UINT num_hashes = ph->num_hashes;
+    const mhash_func hash_func = ph->hash_func;
+    for (size_t i = begin; i < end; ++i) {
+        const MHASH_UINT idx = keys->slot ? (MHASH_UINT)keys->slot(keys, i, num_hashes, ph->table_size)
+            : mhash__concat(hash_func, num_hashes, mhash__key(keys, i)) % (MHASH_UINT)ph->table_size;
+        if (table[idx] != MHASH_EMPTY_SLOT)
+            return i;
+        table[idx] = (MHASH_INDEX_UINT)i;
+    }
+    return end;
+}
 
+// The mhash_init search: tries one more hash per round until every key gets its own slot.
+static inline int mhash__search(MHash *ph, const MHashKeySource *keys) {
+    const size_t worst_case = mhash__worst_case(ph->count);
     for (;;) {
-        for (size_t i = 0; i < table_size; ++i)
-            table[i] = MHASH_EMPTY_SLOT;
+        for (size_t i = 0; i < ph->table_size; ++i)
+            ph->table[i] = MHASH_EMPTY_SLOT;
         if (ph->num_hashes >= worst_case)
             return MHASH_FAILED;
         ph->num_hashes++;
-        int ok = 1;
-        MHASH_UINT num_hashes = ph->num_hashes;
-        mhash_func hash_func = ph->hash_func;
-        for (MHASH_UINT i = 0; i < count; ++i) {
-            MHASH_UINT idx = mhash__concat(hash_func, num_hashes, strings[i]) % (MHASH_UINT)table_size;
-            if (table[idx] != MHASH_EMPTY_SLOT) {
-                ok = 0;
-                break;
-            }
-            table[idx] = i;
-        }
-        if (ok)
+        if (mhash__place(ph, keys, 0, ph->count) == ph->count)
             return MHASH_OK;
     }
 }
 
+// The table size search of MHashMap::build around mhash__search: starts at 3 slots per key
+// and grows the table until fewer than bit_width(count) + 2 hashes place every key. Past
+// min(128 * count, 65536) slots it settles for the last size tried. *table is grown with
+// realloc and belongs to the caller, also when the search fails.
+static inline int mhash__search_table_size(MHash *ph,
+                        MHASH_INDEX_UINT **table,
+                        size_t count,
+                        mhash_func hash_func,
+                        const MHashKeySource *keys) {
+    size_t max_hashes = 2;
+    for (size_t n = count; n; n >>= 1)
+        ++max_hashes;
+    const size_t max_table_size = 128 * (count ? count : 1);
+    size_t table_size = count ? count * 3 : 1;
+    for (;;) {
+        MHASH_INDEX_UINT *grown = (MHASH_INDEX_UINT *)realloc(*table, table_size * sizeof(MHASH_INDEX_UINT));
+        if (!grown)
+            return MHASH_FAILED;
+        *table = grown;
+        mhash__setup(ph, grown, table_size, count, hash_func, 0);
+        const int status = mhash__search(ph, keys);
+        if (status == MHASH_OK && ph->num_hashes < max_hashes)
+            return status;
+        const size_t next = table_size < 16 ? table_size + 1 : table_size + table_size / 5 + 1;
+        if (next > 65536 || next > max_table_size)
+            return status;
+        table_size = next;
+    }
+}
+
+static inline int mhash_init(MHash *ph,
+                        MHASH_INDEX_UINT *table,
+                        size_t table_size,
+                        const void **strings,
+                        size_t count,
+                        mhash_func hash_func) {
+    if (!ph || !table || !strings || table_size == 0)
+        return MHASH_FAILED;
+    mhash__setup(ph, table, table_size, count, hash_func, 0);
+    const MHashKeySource keys = {strings, NULL, NULL, NULL, NULL};
+    return mhash__search(ph, &keys);
+}
+
+
+// Same as mhash_init, but keys are read from one contiguous blob instead of an array of
+// pointers: key i starts at blob + offsets[i] and is NUL-terminated (Arrow-style offsets
+// with count + 1 entries, where each span includes its terminator). Keys are hashed in
+// blob order, so a blob mmapped from disk is streamed sequentially.
+static inline int mhash_init_blob(MHash *ph,
+                        MHASH_INDEX_UINT *table,
+                        size_t table_size,
+                        const char *blob,
+                        const uint32_t *offsets,
+                        size_t count,
+                        mhash_func hash_func) {
+    if (!ph || !table || !blob || !offsets || table_size == 0)
+        return MHASH_FAILED;
+    mhash__setup(ph, table, table_size, count, hash_func, 0);
+    const MHashKeySource keys = {NULL, blob, offsets, NULL, NULL};
+    return mhash__search(ph, &keys);
+}
+
+// Monotone mode: same as mhash_init, but strings must be strictly ascending under
+// cmp_func, which is checked first. Since ids are input positions, every id then equals
+// the rank of its key, so the same keys array serves both point lookups (mhash_rank)
+// and range scans over ids (mhash_lower_bound) without a separate sorted index.
+static inline int mhash_init_sorted(MHash *ph,
+                        MHASH_INDEX_UINT *table,
+                        size_t table_size,
+                        const void **strings,
+                        size_t count,
+                        mhash_func hash_func,
+                        int (*cmp_func)(const void *, const void *)) {
+    if (!strings || !cmp_func)
+        return MHASH_FAILED;
+    for (size_t i = 1; i < count; ++i)
+        if (cmp_func(strings[i - 1], strings[i]) >= 0)
+            return MHASH_FAILED;
+    return mhash_init(ph, table, table_size, strings, count, hash_func);
+}
+
+// Parameters found by a previous search, tied to the key set they were found for.
+// Persist it to skip the search next time (see mhash_init_exact).
+typedef struct MHashHint {
+    uint64_t fingerprint;
+    uint64_t table_size;
+    uint64_t num_hashes;
+} MHashHint;
+
+// Places all keys with exactly num_hashes hashes in a single pass, e.g. with the
+// parameters of an MHashHint whose fingerprint matches the keys.
+static inline int mhash_init_exact(MHash *ph,
+                        MHASH_INDEX_UINT *table,
+                        size_t table_size,
+                        const void **strings,
+                        size_t count,
+                        mhash_func hash_func,
+                        MHASH_UINT num_hashes) {
+    if (!ph || !table || !strings || table_size == 0 || num_hashes == 0)
+        return MHASH_FAILED;
+    mhash__setup(ph, table, table_size, count, hash_func, num_hashes);
+    for (size_t i = 0; i < table_size; ++i)
+        table[i] = MHASH_EMPTY_SLOT;
+    const MHashKeySource keys = {strings, NULL, NULL, NULL, NULL};
+    return mhash__place(ph, &keys, 0, count) == count ? MHASH_OK : MHASH_FAILED;
+}
+
+typedef struct MHashBuilder {
+    MHash *ph;
+    const void **strings;
+    size_t worst_case;
+    size_t cleared;
+    size_t placed;
+} MHashBuilder;
+
+// Resumable version of mhash_init. Nothing is hashed until mhash_build_step is called.
+static inline int mhash_build_begin(MHashBuilder *b,
+                        MHash *ph,
+                        MHASH_INDEX_UINT *table,
+                        size_t table_size,
+                        const void **strings,
+                        size_t count,
+                        mhash_func hash_func) {
+    if (!b || !ph || !table || !strings || table_size == 0)
+        return MHASH_FAILED;
+    mhash__setup(ph, table, table_size, count, hash_func, 0);
+    b->ph = ph;
+    b->strings = strings;
+    b->worst_case = mhash__worst_case(count);
+    b->cleared = 0;
+    b->placed = 0;
+    return MHASH_OK;
+}
+
+// Performs at most `budget` slot clears or key placements of the mhash_init search and
+// returns MHASH_PENDING if more work remains, or the same result mhash_init would give.
+static inline int mhash_build_step(MHashBuilder *b, size_t budget) {
+    if (budget == 0)
+        budget = 1;
+    MHash *ph = b->ph;
+    MHASH_INDEX_UINT *table = ph->table;
+    const size_t table_size = ph->table_size;
+    for (;;) {
+        if (b->cleared < table_size) {
+            size_t end = b->cleared + budget;
+            if (end > table_size) end = table_size;
+            budget -= end - b->cleared;
+            for (size_t i = b->cleared; i < end; ++i)
+                table[i] = MHASH_EMPTY_SLOT;
+            b->cleared = end;
+            if (b->cleared < table_size)
+                return MHASH_PENDING;
+            if (ph->num_hashes >= b->worst_case)
+                return MHASH_FAILED;
+            ph->num_hashes++;
+        }
+        size_t end = b->placed + budget;
+        if (end > ph->count) end = ph->count;
+        budget -= end - b->placed;
+        const MHashKeySource keys = {b->strings, NULL, NULL, NULL, NULL};
+        if (mhash__place(ph, &keys, b->placed, end) < end) {
+            // collision: retry from scratch with one more hash
+            b->cleared = 0;
+            b->placed = 0;
+        } else {
+            b->placed = end;
+        }
+        if (b->cleared && b->placed == ph->count)
+            return MHASH_OK;
+        if (budget == 0)
+            return MHASH_PENDING;
+    }
+}
 
 static inline MHASH_UINT mhash_entry_pos(const MHash *ph, const void *s) {
     return mhash__concat(ph->hash_func, ph->num_hashes, s) % (MHASH_UINT)ph->table_size;
@@ -129,6 +342,85 @@ static inline void *mhash_check_at(const MHash *ph,
     return (char *)values + ((size_t)entry * sizeof_value);
 }
 
+// Returns the id of s, or MHASH_EMPTY_SLOT if it is not a key. For maps built with
+// mhash_init_sorted this is the rank of s among the keys.
+static inline MHASH_INDEX_UINT mhash_rank(const MHash *ph,
+                          const void *s,
+                          const void **keys,
+                          int (*cmp_func)(const void *, const void *)) {
+    MHASH_INDEX_UINT entry = mhash_entry(ph, s);
+    if (entry == MHASH_EMPTY_SLOT || cmp_func(keys[entry], s))
+        return MHASH_EMPTY_SLOT;
+    return entry;
+}
+
+// For maps built with mhash_init_sorted: the rank of the first key not less than s,
+// or ph->count if there is none. Ids [mhash_lower_bound(a), mhash_lower_bound(b)) are
+// the keys in [a, b).
+static inline size_t mhash_lower_bound(const MHash *ph,
+                          const void *s,
+                          const void **keys,
+                          int (*cmp_func)(const void *, const void *)) {
+    size_t lo = 0, hi = ph->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cmp_func(keys[mid], s) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// mhash_check_at for maps built with mhash_init_blob.
+static inline void *mhash_check_at_blob(const MHash *ph,
+                          const void *s,
+                          const char *blob,
+                          const uint32_t *offsets,
+                          void *values,
+                          size_t sizeof_value,
+                          int (*cmp_func)(const void *, const void *)) {
+    MHASH_UINT idx = mhash__concat(ph->hash_func, ph->num_hashes, s) % (MHASH_UINT)ph->table_size;
+    MHASH_INDEX_UINT entry = ph->table[idx];
+    if (entry == MHASH_EMPTY_SLOT)
+        return NULL;
+    if (cmp_func(blob + offsets[entry], s))
+        return NULL;
+    return (char *)values + ((size_t)entry * sizeof_value);
+}
+
+// Batched mhash_check_at: writes the value pointer (or NULL) of each query to results.
+// Queries are processed MHASH_BATCH at a time, prefetching all of their table slots and
+// then all of their keys before comparing, so that memory latencies overlap.
+static inline void mhash_check_at_batch(const MHash *ph,
+                          const void **queries,
+                          size_t num_queries,
+                          const void **keys,
+                          void *values,
+                          size_t sizeof_value,
+                          int (*cmp_func)(const void *, const void *),
+                          void **results) {
+    MHASH_UINT idx[MHASH_BATCH];
+    MHASH_INDEX_UINT entry[MHASH_BATCH];
+    for (size_t base = 0; base < num_queries; base += MHASH_BATCH) {
+        size_t n = num_queries - base;
+        if (n > MHASH_BATCH) n = MHASH_BATCH;
+        for (size_t i = 0; i < n; ++i) {
+            idx[i] = mhash__concat(ph->hash_func, ph->num_hashes, queries[base + i]) % (MHASH_UINT)ph->table_size;
+            MHASH_PREFETCH(&ph->table[idx[i]]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            entry[i] = ph->table[idx[i]];
+            if (entry[i] != MHASH_EMPTY_SLOT)
+                MHASH_PREFETCH(keys[entry[i]]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (entry[i] == MHASH_EMPTY_SLOT || cmp_func(keys[entry[i]], queries[base + i]))
+                results[base + i] = NULL;
+            else
+                results[base + i] = (char *)values + ((size_t)entry[i] * sizeof_value);
+        }
+    }
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2025 Emmanouil Krasanakis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MHASH_ALLOC_H
+#define MHASH_ALLOC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#define MHASH_ALLOC_ALIGN 64
+#define MHASH_HUGE_PAGE_SIZE ((size_t)2 << 20)
+#ifndef MHASH_HUGE_THRESHOLD
+#define MHASH_HUGE_THRESHOLD MHASH_HUGE_PAGE_SIZE
+#endif
+
+#define MHASH_BACKING_ALIGNED 0 // 64-byte aligned, regular pages
+#define MHASH_BACKING_HUGETLB 1 // explicit 2MB pages (MAP_HUGETLB)
+#define MHASH_BACKING_THP 2     // 2MB-aligned with transparent huge pages requested (madvise)
+
+// Every block starts with one cache line holding its backing, so that the returned
+// memory stays 64-byte aligned and mhash_free knows how to release it.
+typedef struct MHashAllocHeader {
+    size_t bytes;
+    int backing;
+} MHashAllocHeader;
+
+static inline void *mhash__aligned(size_t alignment, size_t bytes) {
+#if defined(_WIN32)
+    return _aligned_malloc(bytes, alignment);
+#else
+    void *p = NULL;
+    if (posix_memalign(&p, alignment, bytes))
+        return NULL;
+    return p;
+#endif
+}
+
+static inline void mhash__aligned_free(void *p) {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+// Allocates 64-byte aligned memory for tables and entry arrays. Blocks of at least
+// MHASH_HUGE_THRESHOLD bytes are backed by 2MB pages where the system allows it:
+// explicit huge pages first, then transparent huge pages, then regular pages.
+static inline void *mhash_alloc(size_t bytes) {
+    size_t total = bytes + MHASH_ALLOC_ALIGN;
+    char *block = NULL;
+    int backing = MHASH_BACKING_ALIGNED;
+#if defined(__linux__)
+    if (bytes >= MHASH_HUGE_THRESHOLD) {
+        total = (total + MHASH_HUGE_PAGE_SIZE - 1) & ~(MHASH_HUGE_PAGE_SIZE - 1);
+        void *p = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            block = (char *)p;
+            backing = MHASH_BACKING_HUGETLB;
+        }
+#ifdef MADV_HUGEPAGE
+        else if ((block = (char *)mhash__aligned(MHASH_HUGE_PAGE_SIZE, total)) != NULL) {
+            madvise(block, total, MADV_HUGEPAGE);
+            backing = MHASH_BACKING_THP;
+        }
+#endif
+    }
+#endif
+    if (!block)
+        block = (char *)mhash__aligned(MHASH_ALLOC_ALIGN, total);
+    if (!block)
+        return NULL;
+    MHashAllocHeader *header = (MHashAllocHeader *)block;
+    header->bytes = total;
+    header->backing = backing;
+    return block + MHASH_ALLOC_ALIGN;
+}
+
+static inline int mhash_alloc_backing(const void *p) {
+    return ((const MHashAllocHeader *)((const char *)p - MHASH_ALLOC_ALIGN))->backing;
+}
+
+static inline const char *mhash_backing_name(int backing) {
+    switch (backing) {
+        case MHASH_BACKING_HUGETLB: return "hugetlb";
+        case MHASH_BACKING_THP: return "thp";
+        default: return "aligned";
+    }
+}
+
+static inline void mhash_free(void *p) {
+    if (!p)
+        return;
+    MHashAllocHeader *header = (MHashAllocHeader *)((char *)p - MHASH_ALLOC_ALIGN);
+#if defined(__linux__)
+    if (header->backing == MHASH_BACKING_HUGETLB) {
+        munmap(header, header->bytes);
+        return;
+    }
+#endif
+    mhash__aligned_free(header);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MHASH_ALLOC_H
@@ -0,0 +1,581 @@
+#ifndef MHASH_CONCURRENT_H
+#define MHASH_CONCURRENT_H
+
+#include "mhash_cpp.h"
+#include "mhash_shard.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef MHASH_MAX_READERS
+#define MHASH_MAX_READERS 128
+#endif
+
+// An immutable, already built map. All of its methods only read, so any number of
+// threads may look up concurrently without synchronization.
+template<typename ValueType>
+class MHashFrozenMap {
+    MHashMap<ValueType> map_;
+public:
+    MHashFrozenMap(const std::vector<std::string>& keys, const std::vector<ValueType>& values) {
+        if (keys.size() != values.size())
+            throw std::invalid_argument("Failed to build map: keys and values differ in size.");
+        for (size_t i = 0; i < keys.size(); ++i)
+            map_.insert(keys[i], values[i]);
+        map_.build();
+    }
+    explicit MHashFrozenMap(MHashMap<ValueType>&& map) : map_(std::move(map)) { map_.build(); }
+    MHashFrozenMap(const MHashFrozenMap&) = delete;
+    MHashFrozenMap& operator=(const MHashFrozenMap&) = delete;
+
+    inline const ValueType* get(const std::string& key) const { return map_.get(key); }
+    inline size_t size() const noexcept { return map_.size(); }
+    inline bool empty() const noexcept { return map_.empty(); }
+};
+
+// Publishes immutable snapshots to lock-free readers (RCU-style). Writers build a new
+// snapshot on the side and swap it in with publish(). Each reader thread owns a Reader,
+// whose acquire() announces the current epoch and performs a single atomic load of the
+// snapshot pointer. Replaced snapshots are deleted once no reader that could still see
+// them remains inside an acquire() scope.
+template<typename Snapshot>
+class MHashPublisher {
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<bool> used{false};
+    };
+    struct Retired {
+        const Snapshot* snapshot;
+        uint64_t epoch;
+    };
+    std::atomic<const Snapshot*> current_{nullptr};
+    std::atomic<uint64_t> epoch_{1};
+    std::array<Slot, MHASH_MAX_READERS> slots_;
+    std::mutex writer_mutex_;
+    std::vector<Retired> retired_;
+public:
+    class Guard {
+        Slot* slot_;
+        const Snapshot* snapshot_;
+        friend class MHashPublisher;
+        Guard(Slot* slot, const Snapshot* snapshot) noexcept : slot_(slot), snapshot_(snapshot) {}
+    public:
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard() { slot_->epoch.store(0, std::memory_order_release); }
+        inline const Snapshot* get() const noexcept { return snapshot_; }
+        inline const Snapshot* operator->() const noexcept { return snapshot_; }
+        inline const Snapshot& operator*() const noexcept { return *snapshot_; }
+        inline explicit operator bool() const noexcept { return snapshot_ != nullptr; }
+    };
+
+    // Reader registration for one thread. At most one Guard per Reader may be alive.
+    class Reader {
+        MHashPublisher* publisher_;
+        Slot* slot_ = nullptr;
+    public:
+        explicit Reader(MHashPublisher& publisher) : publisher_(&publisher) {
+            for (Slot& slot : publisher.slots_) {
+                bool expected = false;
+                if (slot.used.compare_exchange_strong(expected, true)) {
+                    slot_ = &slot;
+                    return;
+                }
+            }
+            throw std::runtime_error("Failed to register reader: increase MHASH_MAX_READERS.");
+        }
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        ~Reader() { slot_->used.store(false, std::memory_order_release); }
+
+        inline Guard acquire() const noexcept {
+            slot_->epoch.store(publisher_->epoch_.load(std::memory_order_acquire), std::memory_order_seq_cst);
+            return Guard(slot_, publisher_->current_.load(std::memory_order_seq_cst));
+        }
+    };
+
+    MHashPublisher() = default;
+    explicit MHashPublisher(std::unique_ptr<const Snapshot> initial) { publish(std::move(initial)); }
+    MHashPublisher(const MHashPublisher&) = delete;
+    MHashPublisher& operator=(const MHashPublisher&) = delete;
+    // Readers must be gone before the publisher is destroyed.
+    ~MHashPublisher() {
+        for (const Retired& r : retired_)
+            delete r.snapshot;
+        delete current_.load();
+    }
+
+    void publish(std::unique_ptr<const Snapshot> snapshot) {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        const Snapshot* old = current_.exchange(snapshot.release(), std::memory_order_seq_cst);
+        const uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+        if (old)
+            retired_.push_back({old, epoch});
+        reclaim();
+    }
+
+    // Last published snapshot, unprotected: only the publishing thread may use it.
+    inline const Snapshot* latest() const noexcept { return current_.load(std::memory_order_acquire); }
+
+    // Waits until every reader that acquired a snapshot before the last publish() has
+    // released it. Must not be called while holding a Guard.
+    void synchronize() const {
+        const uint64_t target = epoch_.load(std::memory_order_seq_cst);
+        for (const Slot& slot : slots_) {
+            for (;;) {
+                const uint64_t e = slot.epoch.load(std::memory_order_seq_cst);
+                if (e == 0 || e >= target) break;
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Deletes retired snapshots that no reader can still hold; returns how many are left.
+    size_t collect() {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        reclaim();
+        return retired_.size();
+    }
+
+private:
+    void reclaim() {
+        if (retired_.empty()) return;
+        // readers that announced an epoch at or before a retirement may still hold it
+        uint64_t oldest = UINT64_MAX;
+        for (const Slot& slot : slots_) {
+            const uint64_t e = slot.epoch.load(std::memory_order_seq_cst);
+            if (e && e < oldest) oldest = e;
+        }
+        size_t kept = 0;
+        for (const Retired& r : retired_) {
+            if (r.epoch < oldest) delete r.snapshot;
+            else retired_[kept++] = r;
+        }
+        retired_.resize(kept);
+    }
+};
+
+// Double-buffered map whose builds run on a background worker. insert() and assign()
+// only stage data; build_async() copies the staged key set and hands it to the worker,
+// which builds a new MHashFrozenMap while the published one keeps serving lookups and
+// then publishes it atomically. Builds complete in the order they were requested.
+template<typename ValueType>
+class MHashAsyncMap {
+public:
+    using Snapshot = MHashFrozenMap<ValueType>;
+    using Reader = typename MHashPublisher<Snapshot>::Reader;
+    using Callback = std::function<void(std::exception_ptr)>;
+private:
+    struct Job {
+        std::vector<std::string> keys;
+        std::vector<ValueType> values;
+        std::promise<void> done;
+        Callback callback;
+    };
+    MHashPublisher<Snapshot> published_;
+    std::mutex staging_mutex_;
+    std::vector<std::string> keys_;
+    std::vector<ValueType> values_;
+    std::mutex jobs_mutex_;
+    std::condition_variable jobs_cv_;
+    std::deque<Job> jobs_;
+    bool stop_ = false;
+    std::thread worker_;
+public:
+    MHashAsyncMap() : worker_([this]() { work(); }) {}
+    MHashAsyncMap(const MHashAsyncMap&) = delete;
+    MHashAsyncMap& operator=(const MHashAsyncMap&) = delete;
+    // Builds that have not started yet are abandoned (their futures report broken_promise).
+    ~MHashAsyncMap() {
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex_);
+            stop_ = true;
+        }
+        jobs_cv_.notify_one();
+        worker_.join();
+    }
+
+    inline void insert(const std::string& key, const ValueType& value) {
+        std::lock_guard<std::mutex> lock(staging_mutex_);
+        keys_.push_back(key);
+        values_.push_back(value);
+    }
+
+    // Replaces the whole staged key set, e.g. after reloading it from a file.
+    void assign(std::vector<std::string> keys, std::vector<ValueType> values) {
+        if (keys.size() != values.size())
+            throw std::invalid_argument("Failed to build map: keys and values differ in size.");
+        std::lock_guard<std::mutex> lock(staging_mutex_);
+        keys_ = std::move(keys);
+        values_ = std::move(values);
+    }
+
+    std::future<void> build_async(Callback callback = {}) {
+        Job job;
+        {
+            std::lock_guard<std::mutex> lock(staging_mutex_);
+            job.keys = keys_;
+            job.values = values_;
+        }
+        job.callback = std::move(callback);
+        std::future<void> result = job.done.get_future();
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex_);
+            jobs_.push_back(std::move(job));
+        }
+        jobs_cv_.notify_one();
+        return result;
+    }
+
+    inline void build() { build_async().get(); }
+
+    inline MHashPublisher<Snapshot>& publisher() noexcept { return published_; }
+
+private:
+    void work() {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(jobs_mutex_);
+                jobs_cv_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+                if (stop_) return;
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            std::exception_ptr error;
+            try {
+                published_.publish(std::make_unique<const Snapshot>(job.keys, job.values));
+            } catch (...) {
+                error = std::current_exception();
+            }
+            if (job.callback) {
+                // a throwing callback must not take down the worker; the future reports it
+                try {
+                    job.callback(error);
+                } catch (...) {
+                    if (!error) error = std::current_exception();
+                }
+            }
+            if (error) job.done.set_exception(error);
+            else job.done.set_value();
+        }
+    }
+};
+
+// Polls a key list file (one key per line) and calls on_change with its lines whenever
+// its modification time changes, including once for the initial contents. Exceptions
+// from on_change go to on_error, if given, and the watcher keeps polling.
+class MHashFileWatcher {
+    std::filesystem::path path_;
+    std::chrono::milliseconds interval_;
+    std::function<void(std::vector<std::string>)> on_change_;
+    std::function<void(std::exception_ptr)> on_error_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread thread_;
+public:
+    MHashFileWatcher(std::filesystem::path path,
+                     std::function<void(std::vector<std::string>)> on_change,
+                     std::chrono::milliseconds interval = std::chrono::milliseconds(1000),
+                     std::function<void(std::exception_ptr)> on_error = {})
+        : path_(std::move(path)), interval_(interval), on_change_(std::move(on_change)),
+          on_error_(std::move(on_error)), thread_([this]() { watch(); }) {}
+    MHashFileWatcher(const MHashFileWatcher&) = delete;
+    MHashFileWatcher& operator=(const MHashFileWatcher&) = delete;
+    ~MHashFileWatcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    static std::vector<std::string> read_lines(const std::filesystem::path& path) {
+        std::vector<std::string> lines;
+        std::ifstream in(path);
+        for (std::string line; std::getline(in, line);) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) lines.push_back(std::move(line));
+        }
+        return lines;
+    }
+
+private:
+    void watch() {
+        std::filesystem::file_time_type last{};
+        bool seen = false;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_) {
+            std::error_code ec;
+            const auto time = std::filesystem::last_write_time(path_, ec);
+            if (!ec && (!seen || time != last)) {
+                seen = true;
+                last = time;
+                lock.unlock();
+                try {
+                    on_change_(read_lines(path_));
+                } catch (...) {
+                    if (on_error_) on_error_(std::current_exception());
+                }
+                lock.lock();
+                continue;
+            }
+            cv_.wait_for(lock, interval_, [this]() { return stop_; });
+        }
+    }
+};
+
+// Hybrid map for live inserts from many threads: an immutable sharded perfect-hash core
+// serves the bulk of the keys and a lock-free open-addressing overflow table takes new
+// ones. Lookups check the core first, then the overflow. Once the overflow holds
+// `threshold` keys, a background thread swaps in a fresh overflow, waits for inserts
+// into the old one to drain, and folds it into a new core.
+template<typename ValueType>
+class MHashHybridMap {
+    struct Node {
+        std::string key;
+        ValueType value;
+    };
+    struct Overflow {
+        std::unique_ptr<std::atomic<Node*>[]> slots;
+        size_t mask;
+        unsigned shift;
+        std::atomic<size_t> count{0};
+        // set by a fold once inserts go to the next overflow instead
+        std::atomic<bool> sealed{false};
+        explicit Overflow(size_t capacity) {
+            shift = 64;
+            size_t size = 1;
+            while (size < capacity) { size <<= 1; --shift; }
+            slots.reset(new std::atomic<Node*>[size]);
+            for (size_t i = 0; i < size; ++i)
+                slots[i].store(nullptr, std::memory_order_relaxed);
+            mask = size - 1;
+        }
+        ~Overflow() {
+            for (size_t i = 0; i <= mask; ++i)
+                delete slots[i].load(std::memory_order_relaxed);
+        }
+        inline size_t home(const std::string& key) const noexcept {
+            const uint64_t h = (uint64_t)mhash_str_all(key.c_str(), 1) * 0x9E3779B97F4A7C15ULL;
+            return shift < 64 ? (size_t)(h >> shift) : 0;
+        }
+        const Node* find(const std::string& key) const noexcept {
+            for (size_t i = home(key), probes = 0; probes <= mask; i = (i + 1) & mask, ++probes) {
+                const Node* node = slots[i].load(std::memory_order_acquire);
+                if (!node) return nullptr;
+                if (node->key == key) return node;
+            }
+            return nullptr;
+        }
+        // Returns 1 if inserted, 0 if the key was already present, -1 if the table is full.
+        int insert(const std::string& key, const ValueType& value) {
+            Node* fresh = nullptr;
+            for (size_t i = home(key), probes = 0; probes <= mask; i = (i + 1) & mask, ++probes) {
+                Node* node = slots[i].load(std::memory_order_acquire);
+                if (!node) {
+                    if (!fresh) fresh = new Node{key, value};
+                    if (slots[i].compare_exchange_strong(node, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                        count.fetch_add(1, std::memory_order_relaxed);
+                        return 1;
+                    }
+                }
+                if (node->key == key) {
+                    delete fresh;
+                    return 0;
+                }
+            }
+            delete fresh;
+            return -1;
+        }
+    };
+    struct Generation {
+        std::shared_ptr<const MHashShardedMap<ValueType>> core;
+        std::shared_ptr<Overflow> overflow;
+        std::shared_ptr<Overflow> previous;
+    };
+
+    MHashPublisher<Generation> published_;
+    size_t threshold_;
+    // owned by the freezing thread
+    std::vector<std::string> keys_;
+    std::vector<ValueType> values_;
+    std::mutex freeze_mutex_;
+    std::condition_variable freeze_cv_;
+    std::atomic<bool> freeze_requested_{false};
+    std::atomic<bool> fold_failed_{false};
+    bool stop_ = false;
+    std::thread freezer_;
+public:
+    class Reader {
+        typename MHashPublisher<Generation>::Reader reader_;
+        MHashHybridMap* map_;
+    public:
+        explicit Reader(MHashHybridMap& map) : reader_(map.published_), map_(&map) {}
+
+        std::optional<ValueType> get(const std::string& key) const {
+            auto gen = reader_.acquire();
+            if (const ValueType* v = gen->core->get(key)) return *v;
+            if (const Node* node = gen->overflow->find(key)) return node->value;
+            if (gen->previous)
+                if (const Node* node = gen->previous->find(key)) return node->value;
+            return std::nullopt;
+        }
+
+        // Returns false if the key is already present. If the overflow fills up faster than
+        // it can be folded, waits for the next freeze. Keys with NUL bytes are rejected: the
+        // core sees only the C string before the first one, which may already be a key.
+        bool insert(const std::string& key, const ValueType& value) {
+            if (std::strlen(key.c_str()) != key.size())
+                throw std::invalid_argument("Failed to insert: key contains a NUL byte.");
+            for (;;) {
+                {
+                    auto gen = reader_.acquire();
+                    if (gen->core->get(key)) return false;
+                    Overflow* target = gen->overflow.get();
+                    if (gen->previous) {
+                        // readers of the generation before may still insert into the previous
+                        // overflow, so the same key goes there too until the fold seals it
+                        if (!gen->previous->sealed.load(std::memory_order_seq_cst))
+                            target = gen->previous.get();
+                        else if (gen->previous->find(key))
+                            return false;
+                    }
+                    const int inserted = target->insert(key, value);
+                    if (inserted >= 0) {
+                        if (inserted && target == gen->overflow.get()
+                            && target->count.load(std::memory_order_relaxed) >= map_->threshold_)
+                            map_->request_freeze();
+                        return inserted != 0;
+                    }
+                }
+                map_->request_freeze();
+                if (map_->fold_failed_.load(std::memory_order_relaxed))
+                    throw std::runtime_error("Failed to insert: the overflow is full and could not be folded.");
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    MHashHybridMap(std::vector<std::string> keys, std::vector<ValueType> values, size_t threshold = 4096)
+        : threshold_(threshold ? threshold : 1), keys_(std::move(keys)), values_(std::move(values)) {
+        if (keys_.size() != values_.size())
+            throw std::invalid_argument("Failed to build map: keys and values differ in size.");
+        auto gen = std::make_unique<Generation>();
+        gen->core = make_core();
+        gen->overflow = std::make_shared<Overflow>(threshold_ * 4);
+        published_.publish(std::move(gen));
+        freezer_ = std::thread([this]() { work(); });
+    }
+    MHashHybridMap(const MHashHybridMap&) = delete;
+    MHashHybridMap& operator=(const MHashHybridMap&) = delete;
+    // Readers must be gone before the map is destroyed.
+    ~MHashHybridMap() {
+        {
+            std::lock_guard<std::mutex> lock(freeze_mutex_);
+            stop_ = true;
+        }
+        freeze_cv_.notify_one();
+        freezer_.join();
+    }
+
+    // Folds the overflow into a new core on the calling thread, e.g. before a snapshot.
+    // Must not be called while a Reader of this thread is inside get() or insert().
+    // If building the new core throws, the map keeps serving its current keys and the
+    // next freeze retries.
+    void freeze() {
+        std::lock_guard<std::mutex> lock(freeze_mutex_);
+        fold();
+    }
+
+private:
+    std::shared_ptr<const MHashShardedMap<ValueType>> make_core() {
+        auto core = std::make_shared<MHashShardedMap<ValueType>>();
+        for (size_t i = 0; i < keys_.size(); ++i)
+            core->insert(keys_[i], values_[i]);
+        core->build();
+        return core;
+    }
+
+    inline void request_freeze() {
+        if (!freeze_requested_.exchange(true, std::memory_order_relaxed))
+            freeze_cv_.notify_one();
+    }
+
+    void fold() {
+        freeze_requested_.store(false, std::memory_order_relaxed);
+        Generation next = *published_.latest();
+        // a failed fold leaves its previous overflow in place, which this one retries
+        if (!next.previous) {
+            // route new inserts to a fresh overflow while the old one still serves lookups
+            next.previous = next.overflow;
+            next.overflow = std::make_shared<Overflow>(threshold_ * 4);
+            published_.publish(std::make_unique<Generation>(next));
+            published_.synchronize();
+            // every reader now sees the new overflow, but inserts still go to the previous
+            // one; seal it, then wait out the inserts that started before the seal
+            next.previous->sealed.store(true, std::memory_order_seq_cst);
+            published_.publish(std::make_unique<Generation>(next));
+            published_.synchronize();
+        }
+
+        // no inserts reach the previous overflow anymore
+        const size_t kept = keys_.size();
+        const Overflow& previous = *next.previous;
+        auto folded = std::make_unique<Generation>();
+        try {
+            for (size_t i = 0; i <= previous.mask; ++i) {
+                const Node* node = previous.slots[i].load(std::memory_order_acquire);
+                if (node && !next.core->get(node->key)) {
+                    keys_.push_back(node->key);
+                    values_.push_back(node->value);
+                }
+            }
+            folded->core = make_core();
+        } catch (...) {
+            keys_.erase(keys_.begin() + kept, keys_.end());
+            values_.erase(values_.begin() + kept, values_.end());
+            fold_failed_.store(true, std::memory_order_relaxed);
+            throw;
+        }
+        fold_failed_.store(false, std::memory_order_relaxed);
+        folded->overflow = next.overflow;
+        published_.publish(std::move(folded));
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(freeze_mutex_);
+        while (!stop_) {
+            freeze_cv_.wait_for(lock, std::chrono::milliseconds(10), [this]() {
+                return stop_ || freeze_requested_.load(std::memory_order_relaxed);
+            });
+            if (!stop_ && freeze_requested_.load(std::memory_order_relaxed)) {
+                // nothing to report to on this thread; inserts see fold_failed_ once the overflow is full
+                try {
+                    fold();
+                } catch (...) {
+                }
+            }
+        }
+    }
+};
+
+#endif // MHASH_CONCURRENT_H
@@ -3,12 +3,67 @@
 
 #include "mhash.h"
 #include "mhash_str.h"
+#include "mhash_alloc.h"
+#include "mhash_tiny.h"
+#include "mhash_dispatch.h"
+#include <algorithm>
+#include <atomic>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 #include <bit>
 #include <cstring>
+#include <cstdint>
 #include <cstdlib>
+#include <memory>
+#include <new>
+#include <utility>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Maps with at most this many keys are served by a scan over packed 16-byte key
+// prefixes instead of a hash table. Off by default: the scan did not beat hashing at
+// any size on the machines measured so far, so set it to the crossover that
+// tests/bench_adaptive.cpp reports for yours.
+#ifndef MHASH_SCAN_MAX
+#define MHASH_SCAN_MAX 0
+#endif
+
+// Routes std::vector storage through mhash_alloc: 64-byte aligned, and backed by huge
+// pages once a block reaches MHASH_HUGE_THRESHOLD bytes.
+template<typename T>
+struct MHashAllocator {
+    using value_type = T;
+    MHashAllocator() noexcept = default;
+    template<typename U> MHashAllocator(const MHashAllocator<U>&) noexcept {}
+    inline T* allocate(size_t n) {
+        void* p = mhash_alloc(n * sizeof(T));
+        if (!p) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+    inline void deallocate(T* p, size_t) noexcept { mhash_free(p); }
+    template<typename U> bool operator==(const MHashAllocator<U>&) const noexcept { return true; }
+    template<typename U> bool operator!=(const MHashAllocator<U>&) const noexcept { return false; }
+};
+
+template<typename T>
+inline int mhash_vector_backing(const std::vector<T, MHashAllocator<T>>& v) noexcept {
+    return v.data() ? mhash_alloc_backing(v.data()) : MHASH_BACKING_ALIGNED;
+}
+
+// Tag for maps whose keys match regardless of ASCII letter case.
+struct MHashCaseInsensitive {};
+inline constexpr MHashCaseInsensitive mhash_case_insensitive{};
+
+struct MHashBuildStats {
+    size_t table_size;
+    MHASH_UINT num_hashes;
+    int table_backing;   // MHASH_BACKING_* of the slot table
+    int entries_backing; // MHASH_BACKING_* of the entry (or value) array
+};
 
 template<typename ValueType>
 class MHashMap {
@@ -16,14 +71,37 @@ class MHashMap {
         std::string key;
         ValueType value;
     };
+    // first 16 bytes of a key, zero-padded
+    struct alignas(16) Prefix {
+        char bytes[16];
+    };
     MHash mhash_{};
-    std::vector<MHASH_INDEX_UINT> table_;
-    std::vector<Entry> entries_;
+    // slot routine for the built number of hashes, bound by every build
+    using PosFunc = MHASH_UINT (MHashMap::*)(const char*) const noexcept;
+    PosFunc pos_ = &MHashMap::pos_dynamic;
+    MHashHint hint_{};
+    std::vector<MHASH_INDEX_UINT, MHashAllocator<MHASH_INDEX_UINT>> table_;
+    std::vector<Entry, MHashAllocator<Entry>> entries_;
+    std::vector<size_t> ids_; // insertion id of each entry once reordered, empty otherwise
+    // tiny maps scan prefixes_ (one per entry) instead of hashing
+    std::vector<Prefix, MHashAllocator<Prefix>> prefixes_;
+    size_t scan_max_ = MHASH_SCAN_MAX;
+    bool scan_ = false;
+    bool nocase_ = false; // keys are stored lowercase and queries folded while hashed and compared
+    // access sampling for optimize_layout, off while sample_period_ is 0
+    std::unique_ptr<std::atomic<uint32_t>[]> hits_;
+    uint32_t sample_period_ = 0;
+    mutable std::atomic<uint32_t> countdown_{0}; // gets until the next sample
     // staging before build
     std::vector<std::string> staged_keys_;
     std::vector<ValueType> staged_values_;
 public:
     MHashMap() = default;
+    // Builds of up to scan_max keys use the prefix scan; 0 always hashes.
+    explicit MHashMap(size_t scan_max) : scan_max_(scan_max) {}
+    // Keys match in any ASCII letter case, without lowercasing queries into a copy.
+    // for_each() then visits the lowercase keys.
+    explicit MHashMap(MHashCaseInsensitive, size_t scan_max = MHASH_SCAN_MAX) : scan_max_(scan_max), nocase_(true) {}
     MHashMap(const MHashMap&) = delete;
     MHashMap& operator=(const MHashMap&) = delete;
     MHashMap(MHashMap&& o) noexcept { move_from(std::move(o)); }
@@ -35,22 +113,25 @@ public:
 
     inline void insert(const std::string& key, const ValueType& value) {
         staged_keys_.push_back(key);
+        if (nocase_)
+            for (char& c : staged_keys_.back())
+                c = (char)mhash_str_fold((unsigned char)c);
         staged_values_.push_back(value);
     }
 
     inline ValueType* get(const std::string& key) {
-        const MHASH_UINT pos = mhash_entry_pos(&mhash_, key.c_str());
-        const MHASH_INDEX_UINT entry_idx = mhash_.table[pos];
+        const MHASH_INDEX_UINT entry_idx = find(key);
         if (entry_idx == MHASH_EMPTY_SLOT) [[unlikely]]
             return nullptr;
-        Entry& e = entries_[entry_idx];
-        if(e.key != key) [[unlikely]]
-            return nullptr;
-        return &e.value;
+        if (sample_period_) [[unlikely]]
+            sample(entry_idx);
+        return &entries_[entry_idx].value;
     }
 
     inline ValueType* get_existing(const std::string& key) {
-        const MHASH_UINT pos = mhash_entry_pos(&mhash_, key.c_str());
+        if (scan_) [[unlikely]]
+            return &entries_[scan(key)].value;
+        const MHASH_UINT pos = (this->*pos_)(key.c_str());
         const MHASH_INDEX_UINT entry_idx = mhash_.table[pos];
         //if (entry_idx == MHASH_EMPTY_SLOT) [[unlikely]]
         //    return nullptr;
@@ -62,40 +143,359 @@ public:
         return const_cast<MHashMap*>(this)->get(key);
     }
 
+    // Looks up keys[0..n) into out, MHASH_BATCH at a time with prefetching.
+    void get_many(const std::string* keys, size_t n, ValueType** out) {
+        if (scan_ || entries_.empty()) {
+            for (size_t i = 0; i < n; ++i)
+                out[i] = get(keys[i]);
+            return;
+        }
+        MHASH_UINT pos[MHASH_BATCH];
+        MHASH_INDEX_UINT entry[MHASH_BATCH];
+        for (size_t base = 0; base < n; base += MHASH_BATCH) {
+            const size_t m = std::min<size_t>(MHASH_BATCH, n - base);
+            for (size_t i = 0; i < m; ++i) {
+                pos[i] = (this->*pos_)(keys[base + i].c_str());
+                MHASH_PREFETCH(&mhash_.table[pos[i]]);
+            }
+            for (size_t i = 0; i < m; ++i) {
+                entry[i] = mhash_.table[pos[i]];
+                if (entry[i] != MHASH_EMPTY_SLOT)
+                    MHASH_PREFETCH(&entries_[entry[i]]);
+            }
+            for (size_t i = 0; i < m; ++i) {
+                if (entry[i] == MHASH_EMPTY_SLOT || !same_key(entries_[entry[i]].key, keys[base + i])) [[unlikely]]
+                    out[base + i] = nullptr;
+                else
+                    out[base + i] = &entries_[entry[i]].value;
+            }
+        }
+    }
+
+    inline void get_many(const std::string* keys, size_t n, const ValueType** out) const {
+        const_cast<MHashMap*>(this)->get_many(keys, n, const_cast<ValueType**>(out));
+    }
+
+    // Splits the queries into chunks that worker threads claim until none are left. Each
+    // worker runs get_many on its chunks and writes only its own part of out.
+    void parallel_get_many(const std::string* keys, size_t n, const ValueType** out,
+                           unsigned num_threads = std::thread::hardware_concurrency()) const {
+        constexpr size_t chunk = 4096;
+        if (num_threads <= 1 || n <= chunk) {
+            get_many(keys, n, out);
+            return;
+        }
+        std::atomic<size_t> next{0};
+        auto worker = [&]() {
+            for (size_t begin; (begin = next.fetch_add(chunk, std::memory_order_relaxed)) < n;)
+                get_many(keys + begin, std::min(chunk, n - begin), out + begin);
+        };
+        std::vector<std::thread> threads;
+        for (unsigned t = 1; t < num_threads; ++t)
+            threads.emplace_back(worker);
+        worker();
+        for (auto& t : threads)
+            t.join();
+    }
+
+    // Insertion order id of key (0 for the first inserted key), or SIZE_MAX if missing.
+    // Stays the same when order_by_slots() moves entries around.
+    inline size_t id(const std::string& key) const {
+        const MHASH_INDEX_UINT entry_idx = find(key);
+        if (entry_idx == MHASH_EMPTY_SLOT)
+            return SIZE_MAX;
+        return ids_.empty() ? (size_t)entry_idx : ids_[entry_idx];
+    }
+
+    // Visits (key, value) pairs in storage order, which is table order after order_by_slots().
+    template<typename Func>
+    void for_each(Func&& func) const {
+        for (const Entry& e : entries_)
+            func(e.key, e.value);
+    }
+
+    // Permutes entries to follow table slot order, so that scans and batches of lookups
+    // over neighbouring slots read neighbouring entries. Insertion ids remain available
+    // through id(), which is the only user of the extra indirection. Entries added by a
+    // later build() are appended after the ordered ones until this is called again.
+    void order_by_slots() {
+        if (entries_.empty() || scan_) return;
+        std::vector<size_t> order;
+        order.reserve(entries_.size());
+        for (MHASH_INDEX_UINT slot : table_)
+            if (slot != MHASH_EMPTY_SLOT)
+                order.push_back((size_t)slot);
+        permute_entries(order);
+    }
+
+    // Counts every period-th successful get() per entry (one countdown per map, relaxed
+    // atomic counters), as input for optimize_layout(). A period of 0 turns sampling off.
+    void enable_sampling(uint32_t period = 64) {
+        sample_period_ = period;
+        reset_samples();
+    }
+
+    // Reorders entries by sampled hits so that the keys receiving hot_fraction of the
+    // lookups share the first few cache lines. Among table sizes that place all keys with
+    // the current number of hashes, it also picks the one that puts the hot keys in the
+    // fewest slot cache lines. Insertion ids stay available through id(), and the samples
+    // restart afterwards.
+    void optimize_layout(double hot_fraction = 0.95) {
+        const size_t n = entries_.size();
+        if (n == 0 || !hits_) return;
+        std::vector<size_t> order(n);
+        for (size_t i = 0; i < n; ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return hits_[a].load(std::memory_order_relaxed) > hits_[b].load(std::memory_order_relaxed);
+        });
+        uint64_t total = 0;
+        for (size_t i = 0; i < n; ++i)
+            total += hits_[i].load(std::memory_order_relaxed);
+        size_t hot = 0;
+        for (uint64_t covered = 0; hot < n && covered < hot_fraction * total; ++hot)
+            covered += hits_[order[hot]].load(std::memory_order_relaxed);
+
+        if (hot && !scan_) {
+            std::vector<const void*> key_ptrs(n);
+            for (size_t i = 0; i < n; ++i)
+                key_ptrs[i] = entries_[i].key.c_str();
+            constexpr size_t slots_per_line = 64 / sizeof(MHASH_INDEX_UINT);
+            std::vector<MHASH_INDEX_UINT> candidate;
+            std::vector<size_t> lines;
+            size_t best_size = mhash_.table_size, best_lines = SIZE_MAX;
+            const size_t last_size = mhash_.table_size + std::min<size_t>(32, mhash_.table_size / 4);
+            for (size_t size = mhash_.table_size; size <= last_size; ++size) {
+                MHash trial;
+                candidate.assign(size, MHASH_EMPTY_SLOT);
+                if (mhash_init_exact(&trial, candidate.data(), size, key_ptrs.data(), n,
+                                     mhash_str_prefix, mhash_.num_hashes) != MHASH_OK)
+                    continue;
+                lines.clear();
+                for (size_t i = 0; i < hot; ++i)
+                    lines.push_back(mhash_entry_pos(&trial, key_ptrs[order[i]]) / slots_per_line);
+                std::sort(lines.begin(), lines.end());
+                const size_t count = (size_t)(std::unique(lines.begin(), lines.end()) - lines.begin());
+                if (count < best_lines) {
+                    best_lines = count;
+                    best_size = size;
+                }
+            }
+            if (best_size != mhash_.table_size) {
+                table_.assign(best_size, MHASH_EMPTY_SLOT);
+                mhash_init_exact(&mhash_, table_.data(), best_size, key_ptrs.data(), n,
+                                 mhash_str_prefix, mhash_.num_hashes);
+                hint_.table_size = mhash_.table_size;
+            }
+        }
+        permute_entries(order);
+    }
+
+    // Whether the last build chose the prefix scan over the hash table.
+    inline bool scanning() const noexcept { return scan_; }
+
     inline size_t size() const noexcept { return entries_.size(); }
     inline bool empty() const noexcept { return entries_.empty(); }
 
-    void build() {
-        if (staged_keys_.empty()) return;
+    inline const MHashHint& hint() const noexcept { return hint_; }
+
+    inline MHashBuildStats stats() const noexcept {
+        return {mhash_.table_size, mhash_.num_hashes, mhash_vector_backing(table_), mhash_vector_backing(entries_)};
+    }
+
+    // Builds staged keys into the map and returns the parameters it settled on. Passing
+    // back the hint of a previous build of the same keys skips the parameter search.
+    MHashHint build(const MHashHint* hint = nullptr) {
+        if (staged_keys_.empty()) return hint_;
         const size_t new_count = staged_keys_.size();
         const size_t old_count = entries_.size();
         const size_t total_count = old_count + new_count;
         entries_.reserve(total_count);
         for (size_t i = 0; i < new_count; ++i)
             entries_.push_back({std::move(staged_keys_[i]), staged_values_[i]});
+        if (!ids_.empty())
+            for (size_t i = old_count; i < total_count; ++i)
+                ids_.push_back(i);
         staged_keys_.clear();
         staged_values_.clear();
-        rebuild();
+        rebuild(hint);
+        reset_samples();
+        return hint_;
     }
 
     void clear() {
         cleanup();
         entries_.clear();
+        ids_.clear();
+        hits_.reset();
         staged_keys_.clear();
         staged_values_.clear();
     }
 
 private:
-    void rebuild() {
+    inline MHASH_INDEX_UINT find(const std::string& key) const {
+        // an empty (or never built) map has no table to reduce positions into
+        if (entries_.empty()) [[unlikely]]
+            return MHASH_EMPTY_SLOT;
+        if (scan_)
+            return scan(key);
+        const MHASH_INDEX_UINT entry_idx = mhash_.table[(this->*pos_)(key.c_str())];
+        if (entry_idx == MHASH_EMPTY_SLOT || !same_key(entries_[entry_idx].key, key)) [[unlikely]]
+            return MHASH_EMPTY_SLOT;
+        return entry_idx;
+    }
+
+    // Compares a stored key with a query, up to letter case for case-insensitive maps.
+    inline bool same_key(const std::string& stored, const std::string& key) const noexcept {
+        if (!nocase_)
+            return stored == key;
+        return stored.size() == key.size() && mhash_str_equal_nocase(stored.data(), key.data(), key.size());
+    }
+
+    // Compares the first 16 bytes of key against 64 prefixes at a time without branching,
+    // then checks the rest of the key only where a prefix matched.
+    inline MHASH_INDEX_UINT scan(const std::string& key) const {
+        const size_t n = prefixes_.size();
+#if defined(__SSE2__)
+        const __m128i needle = nocase_ ? mhash_str_fold16(load_prefix(key)) : load_prefix(key);
+#else
+        Prefix query{};
+        std::memcpy(query.bytes, key.data(), std::min<size_t>(key.size(), sizeof(query.bytes)));
+        if (nocase_)
+            for (char& c : query.bytes)
+                c = (char)mhash_str_fold((unsigned char)c);
+#endif
+        for (size_t base = 0; base < n; base += 64) {
+            const size_t end = std::min<size_t>(n, base + 64);
+            uint64_t matches = 0;
+            for (size_t i = base; i < end; ++i) {
+#if defined(__SSE2__)
+                const __m128i eq = _mm_cmpeq_epi8(needle, _mm_load_si128(reinterpret_cast<const __m128i*>(prefixes_[i].bytes)));
+                matches |= (uint64_t)(_mm_movemask_epi8(eq) == 0xFFFF) << (i - base);
+#else
+                matches |= (uint64_t)(std::memcmp(query.bytes, prefixes_[i].bytes, sizeof(query.bytes)) == 0) << (i - base);
+#endif
+            }
+            for (; matches; matches &= matches - 1) {
+                const size_t i = base + (size_t)std::countr_zero(matches);
+                // keys that fit in the prefix only differ by length (e.g. trailing NULs)
+                const std::string& candidate = entries_[i].key;
+                if (key.size() <= sizeof(Prefix::bytes) ? candidate.size() == key.size() : same_key(candidate, key))
+                    return (MHASH_INDEX_UINT)i;
+            }
+        }
+        return MHASH_EMPTY_SLOT;
+    }
+
+#if defined(__SSE2__)
+    // Zero-padded first 16 bytes of key. Short keys are loaded whole and masked unless
+    // the 16 bytes would cross a page boundary (short strings normally live in the inline
+    // buffer of std::string anyway), which avoids a store-forwarding stall on a copy.
+    static inline __m128i load_prefix(const std::string& key) noexcept {
+        const char* p = key.data();
+        if (key.size() >= 16)
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        if (((uintptr_t)p & 4095) <= 4096 - 16) {
+            const __m128i lane = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+            const __m128i keep = _mm_cmplt_epi8(lane, _mm_set1_epi8((char)key.size()));
+            return _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), keep);
+        }
+        Prefix query{};
+        std::memcpy(query.bytes, p, key.size());
+        return _mm_load_si128(reinterpret_cast<const __m128i*>(query.bytes));
+    }
+#endif
+
+    void build_prefixes() {
+        prefixes_.assign(entries_.size(), Prefix{});
+        for (size_t i = 0; i < entries_.size(); ++i)
+            std::memcpy(prefixes_[i].bytes, entries_[i].key.data(),
+                        std::min<size_t>(entries_[i].key.size(), sizeof(Prefix::bytes)));
+    }
+
+    // Concurrent readers may overwrite each other's countdown, which only stretches the
+    // period; plain loads and stores avoid a locked read-modify-write on every get().
+    inline void sample(MHASH_INDEX_UINT entry_idx) const noexcept {
+        const uint32_t countdown = countdown_.load(std::memory_order_relaxed);
+        if (countdown == 0) {
+            countdown_.store(sample_period_ - 1, std::memory_order_relaxed);
+            hits_[entry_idx].fetch_add(1, std::memory_order_relaxed);
+        } else {
+            countdown_.store(countdown - 1, std::memory_order_relaxed);
+        }
+    }
+
+    void reset_samples() {
+        countdown_.store(0, std::memory_order_relaxed);
+        if (!sample_period_) {
+            hits_.reset();
+            return;
+        }
+        hits_.reset(new std::atomic<uint32_t>[entries_.size()]);
+        for (size_t i = 0; i < entries_.size(); ++i)
+            hits_[i].store(0, std::memory_order_relaxed);
+    }
+
+    // Moves entry order[i] to position i, keeping the table, insertion ids and hint in step.
+    void permute_entries(const std::vector<size_t>& order) {
+        const size_t n = entries_.size();
+        std::vector<MHASH_INDEX_UINT> position(n);
+        std::vector<size_t> ids(n);
+        std::vector<Entry, MHashAllocator<Entry>> entries;
+        entries.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            position[order[i]] = (MHASH_INDEX_UINT)i;
+            ids[i] = ids_.empty() ? order[i] : ids_[order[i]];
+            entries.push_back(std::move(entries_[order[i]]));
+        }
+        for (MHASH_INDEX_UINT& slot : table_)
+            if (slot != MHASH_EMPTY_SLOT)
+                slot = position[slot];
+        entries_ = std::move(entries);
+        ids_ = std::move(ids);
+        if (scan_)
+            build_prefixes();
+        reset_samples();
+        // the same parameters place the reordered keys and the fingerprint ignores order,
+        // so hint_ stays valid
+    }
+
+    void rebuild(const MHashHint* hint) {
         if (entries_.empty()) return;
         const size_t n = entries_.size();
+        std::vector<const void*> key_ptrs(n);
+        for (size_t i = 0; i < n; ++i)
+            key_ptrs[i] = entries_[i].key.c_str();
+        hint_ = {mhash_str_fingerprint(key_ptrs.data(), n), 0, 0};
+        scan_ = n <= scan_max_;
+        if (scan_) {
+            // duplicate keys would make the later one unreachable, like a failed hash build
+            std::vector<const char*> sorted(n);
+            for (size_t i = 0; i < n; ++i)
+                sorted[i] = entries_[i].key.c_str();
+            std::sort(sorted.begin(), sorted.end(), [](const char* a, const char* b) { return std::strcmp(a, b) < 0; });
+            for (size_t i = 1; i < n; ++i)
+                if (!std::strcmp(sorted[i - 1], sorted[i]))
+                    throw std::runtime_error("Failed to build map: either too many collisions, too many keys, or duplicate keys.");
+            table_.clear();
+            mhash_ = {};
+            build_prefixes();
+            return;
+        }
+        prefixes_.clear();
+        if (hint && hint->fingerprint == hint_.fingerprint && hint->table_size) {
+            table_.assign(hint->table_size, MHASH_EMPTY_SLOT);
+            if (mhash_init_exact(&mhash_, table_.data(), hint->table_size, key_ptrs.data(), n,
+                                 mhash_str_prefix, (MHASH_UINT)hint->num_hashes) == MHASH_OK) {
+                hint_ = *hint;
+                pos_ = select_pos(mhash_.num_hashes);
+                return;
+            }
+        }
         size_t table_size = n * 3;
         const size_t max_hashes = std::bit_width(n) + 2;
         const size_t max_table_size = 128 * n;
         table_.assign(table_size, MHASH_EMPTY_SLOT);
-        std::vector<const void*> key_ptrs(n);
-        for (size_t i = 0; i < n; ++i)
-            key_ptrs[i] = entries_[i].key.c_str();
         for (;;) {
             const int success = (mhash_init(&mhash_, table_.data(), table_size, key_ptrs.data(), n, mhash_str_prefix) == MHASH_OK);
             if(success && mhash_.num_hashes < max_hashes) break;
@@ -107,23 +507,313 @@ private:
             }
             table_.assign(table_size, MHASH_EMPTY_SLOT);
         }
+        hint_.table_size = mhash_.table_size;
+        hint_.num_hashes = mhash_.num_hashes;
+        pos_ = select_pos(mhash_.num_hashes);
     }
 
     static inline MHASH_UINT mhash_entry_pos(const MHash *ph, const void *s) {
         return mhash__concat(ph->hash_func, ph->num_hashes, s) % (MHASH_UINT)ph->table_size;
     }
+
+    MHASH_UINT pos_dynamic(const char* s) const noexcept {
+        return mhash_entry_pos(&mhash_, s);
+    }
+
+    // lowercase keys were placed with mhash_str_prefix, which the nocase family matches
+    MHASH_UINT pos_dynamic_nocase(const char* s) const noexcept {
+        return mhash__concat(mhash_str_prefix_nocase, mhash_.num_hashes, s) % (MHASH_UINT)mhash_.table_size;
+    }
+
+    // mhash__concat over mhash_str_prefix with the hash count known at compile time, so
+    // the loop unrolls and every hash inlines.
+    template<MHASH_UINT... Ids>
+    static inline MHASH_UINT concat_fixed(const char* s, std::integer_sequence<MHASH_UINT, Ids...>) noexcept {
+        return (MHASH_UINT(0) ^ ... ^ mhash_str_prefix(s, Ids + 1));
+    }
+
+    template<MHASH_UINT... Ids>
+    static inline MHASH_UINT concat_fixed_nocase(const char* s, std::integer_sequence<MHASH_UINT, Ids...> ids) noexcept {
+        if constexpr (sizeof...(Ids) <= 16) {
+            // levels read at most NumHashes bytes, so fold those once
+            char folded[16];
+            mhash_str_fold_prefix(folded, s, sizeof...(Ids));
+            return concat_fixed(folded, ids);
+        } else {
+            return (MHASH_UINT(0) ^ ... ^ mhash_str_prefix_nocase(s, Ids + 1));
+        }
+    }
+
+    template<MHASH_UINT NumHashes, bool NoCase>
+    MHASH_UINT pos_fixed(const char* s) const noexcept {
+        constexpr auto ids = std::make_integer_sequence<MHASH_UINT, NumHashes>{};
+        if constexpr (NoCase)
+            return concat_fixed_nocase(s, ids) % (MHASH_UINT)mhash_.table_size;
+        else
+            return concat_fixed(s, ids) % (MHASH_UINT)mhash_.table_size;
+    }
+
+    template<MHASH_UINT... Counts>
+    static PosFunc select_pos(MHASH_UINT num_hashes, bool nocase, std::integer_sequence<MHASH_UINT, Counts...>) noexcept {
+        static constexpr PosFunc routines[] = {&MHashMap::pos_fixed<Counts + 1, false>...};
+        static constexpr PosFunc nocase_routines[] = {&MHashMap::pos_fixed<Counts + 1, true>...};
+        if (num_hashes < 1 || num_hashes > sizeof...(Counts))
+            return nocase ? &MHashMap::pos_dynamic_nocase : &MHashMap::pos_dynamic;
+        return nocase ? nocase_routines[num_hashes - 1] : routines[num_hashes - 1];
+    }
+
+    // Picks the routine unrolled for num_hashes (1..MHASH_MAX_HASHES) once per build.
+    PosFunc select_pos(MHASH_UINT num_hashes) const noexcept {
+        return select_pos(num_hashes, nocase_, std::make_integer_sequence<MHASH_UINT, MHASH_MAX_HASHES>{});
+    }
     void move_from(MHashMap&& o) noexcept {
         mhash_ = o.mhash_;
+        pos_ = o.pos_;
+        hint_ = o.hint_;
         table_ = std::move(o.table_);
         entries_ = std::move(o.entries_);
+        ids_ = std::move(o.ids_);
+        prefixes_ = std::move(o.prefixes_);
+        scan_max_ = o.scan_max_;
+        scan_ = o.scan_;
+        nocase_ = o.nocase_;
+        hits_ = std::move(o.hits_);
+        sample_period_ = o.sample_period_;
+        countdown_.store(o.countdown_.load(std::memory_order_relaxed), std::memory_order_relaxed);
         staged_keys_ = std::move(o.staged_keys_);
         staged_values_ = std::move(o.staged_values_);
         mhash_.table = table_.data();
     }
     void cleanup() noexcept {
         table_.clear();
+        prefixes_.clear();
+        scan_ = false;
         mhash_ = {};
+        pos_ = &MHashMap::pos_dynamic;
+        hint_ = {};
     }
 };
 
+// Map of at most MHASH_TINY_MAX_KEYS keys on the compact mhash_tiny.h index, whose
+// pilots and uint8 slots usually fit in one or two cache lines.
+template<typename ValueType>
+class MHashTinyMap {
+    MHashTiny tiny_;
+    std::vector<std::string> keys_;
+    std::vector<ValueType> values_;
+public:
+    MHashTinyMap() { mhash_tiny_init(&tiny_, nullptr, 0); }
+
+    inline void insert(const std::string& key, const ValueType& value) {
+        keys_.push_back(key);
+        values_.push_back(value);
+    }
+
+    // Indexes all inserted keys; they become visible to get() only after this.
+    void build() {
+        std::vector<const void*> key_ptrs(keys_.size());
+        for (size_t i = 0; i < keys_.size(); ++i)
+            key_ptrs[i] = keys_[i].c_str();
+        if (mhash_tiny_init(&tiny_, key_ptrs.data(), key_ptrs.size()) != MHASH_OK) {
+            mhash_tiny_init(&tiny_, nullptr, 0);
+            throw std::runtime_error("Failed to build tiny map: too many keys or duplicate keys.");
+        }
+    }
+
+    inline ValueType* get(const std::string& key) {
+        const uint8_t entry = mhash_tiny_entry(&tiny_, key.c_str());
+        if (entry == MHASH_TINY_EMPTY || keys_[entry] != key) [[unlikely]]
+            return nullptr;
+        return &values_[entry];
+    }
+
+    inline const ValueType* get(const std::string& key) const {
+        return const_cast<MHashTinyMap*>(this)->get(key);
+    }
+
+    inline size_t size() const noexcept { return tiny_.params.count; }
+    inline bool empty() const noexcept { return tiny_.params.count == 0; }
+    inline size_t index_bytes() const noexcept { return mhash_tiny_bytes(&tiny_); }
+};
+
+// Map of up to N keys whose index, keys (KeyBytes including terminators) and values are
+// stored inline, so construction and inserts within those bounds allocate nothing and a
+// lookup stays within the object. Keys are indexed as they are inserted, without a build
+// step. Past either bound the inline entries move to a heap-allocated MHashMap and the
+// inline storage takes the next inserts. Heap maps of similar size are merged as they
+// pile up, so each entry is rebuilt O(log n) times and lookups check O(log n) maps.
+template<typename ValueType, size_t N, size_t KeyBytes = 16 * N>
+class SmallMHashMap {
+    static_assert(N > 0 && N <= 64, "SmallMHashMap keeps at most 64 entries inline");
+    static_assert(KeyBytes <= 65535, "key offsets are 16-bit");
+    static constexpr size_t IndexBytes = 3 * N + 1; // pilots and slots
+    using Spill = std::vector<MHashMap<ValueType>>; // each less than half the size of the one before
+    MHashTinyParams params_{};
+    uint8_t index_[IndexBytes];
+    uint16_t offsets_[N + 1] = {};
+    char pool_[KeyBytes];
+    ValueType values_[N]{};
+    std::unique_ptr<Spill> spill_;
+
+    // Indexes key inline if it fits, leaving the map as it was otherwise.
+    bool insert_inline(const std::string& key, const ValueType& value) {
+        const size_t count = params_.count, used = offsets_[count];
+        if (count == N || used + key.size() + 1 > KeyBytes || std::strlen(key.c_str()) != key.size())
+            return false;
+        std::memcpy(pool_ + used, key.c_str(), key.size() + 1);
+        const void* keys[N];
+        for (size_t i = 0; i < count; ++i)
+            keys[i] = pool_ + offsets_[i];
+        keys[count] = pool_ + used;
+        // a failed build clears the params and index it was given
+        MHashTinyParams params;
+        uint8_t index[IndexBytes];
+        if (mhash_tiny_build(&params, index, IndexBytes, keys, count + 1) != MHASH_OK)
+            return false;
+        offsets_[count + 1] = (uint16_t)(used + key.size() + 1);
+        values_[count] = value;
+        params_ = params;
+        std::memcpy(index_, index, IndexBytes);
+        return true;
+    }
+
+    // Moves the inline entries to a new heap map, or only key when there are none.
+    void spill(const std::string& key, const ValueType& value) {
+        const size_t count = params_.count;
+        MHashMap<ValueType> level;
+        for (size_t i = 0; i < count; ++i)
+            level.insert(std::string(pool_ + offsets_[i]), values_[i]);
+        if (!count)
+            level.insert(key, value);
+        level.build();
+        if (!spill_)
+            spill_ = std::make_unique<Spill>();
+        spill_->push_back(std::move(level));
+        if (count)
+            mhash_tiny_build(&params_, index_, IndexBytes, nullptr, 0);
+        while (spill_->size() >= 2 && 2 * spill_->back().size() >= (*spill_)[spill_->size() - 2].size()) {
+            MHashMap<ValueType> merged;
+            for (size_t i = spill_->size() - 2; i < spill_->size(); ++i)
+                (*spill_)[i].for_each([&](const std::string& k, const ValueType& v) { merged.insert(k, v); });
+            try {
+                merged.build();
+            } catch (const std::runtime_error&) {
+                break; // keys that only separate maps tell apart stay split
+            }
+            spill_->pop_back();
+            spill_->back() = std::move(merged);
+        }
+    }
+public:
+    SmallMHashMap() { mhash_tiny_build(&params_, index_, IndexBytes, nullptr, 0); }
+    SmallMHashMap(SmallMHashMap&&) noexcept = default;
+    SmallMHashMap& operator=(SmallMHashMap&&) noexcept = default;
+
+    void insert(const std::string& key, const ValueType& value) {
+        // checked first so that a duplicate never reaches a heap map
+        if (get(key))
+            throw std::runtime_error("Failed to insert: duplicate key.");
+        if (insert_inline(key, value))
+            return;
+        const bool had_inline = params_.count;
+        spill(key, value);
+        if (had_inline && !insert_inline(key, value))
+            spill(key, value);
+    }
+
+    inline ValueType* get(const std::string& key) {
+        if (spill_) [[unlikely]]
+            for (MHashMap<ValueType>& level : *spill_)
+                if (ValueType* value = level.get(key))
+                    return value;
+        const uint8_t entry = mhash_tiny_lookup(&params_, index_, key.c_str());
+        if (entry == MHASH_TINY_EMPTY) [[unlikely]]
+            return nullptr;
+        const size_t length = offsets_[entry + 1] - offsets_[entry] - 1;
+        if (length != key.size() || std::memcmp(pool_ + offsets_[entry], key.data(), length)) [[unlikely]]
+            return nullptr;
+        return &values_[entry];
+    }
+
+    inline const ValueType* get(const std::string& key) const {
+        return const_cast<SmallMHashMap*>(this)->get(key);
+    }
+
+    inline size_t size() const noexcept {
+        size_t n = params_.count;
+        if (spill_)
+            for (const MHashMap<ValueType>& level : *spill_)
+                n += level.size();
+        return n;
+    }
+    inline bool empty() const noexcept { return size() == 0; }
+    // Whether entries have moved to the heap.
+    inline bool spilled() const noexcept { return (bool)spill_; }
+};
+
+// Name-to-handler dispatch on mhash_dispatch.h for handlers of signature Sig, e.g.
+// MHashDispatcher<int(Connection&, std::string_view)>. Handlers are function pointers
+// (captureless lambdas convert), stored next to their names; a call hashes the name,
+// reads one slot and one record, and jumps to the handler.
+template<typename Sig>
+class MHashDispatcher;
+
+template<typename R, typename... Args>
+class MHashDispatcher<R(Args...)> {
+public:
+    using Handler = R (*)(Args...);
+private:
+    MHashDispatch dispatch_{};
+    std::vector<std::string> names_;
+    std::vector<Handler> handlers_;
+    Handler fallback_ = nullptr;
+    int flags_;
+
+    void release() noexcept { mhash_dispatch_free(&dispatch_); }
+public:
+    explicit MHashDispatcher(bool case_insensitive = false)
+        : flags_(case_insensitive ? MHASH_DISPATCH_NOCASE : 0) {}
+    ~MHashDispatcher() { release(); }
+    MHashDispatcher(const MHashDispatcher&) = delete;
+    MHashDispatcher& operator=(const MHashDispatcher&) = delete;
+
+    inline void add(const std::string& name, Handler handler) {
+        names_.push_back(name);
+        handlers_.push_back(handler);
+    }
+
+    // Called by operator() for unknown names; without it, they return R().
+    inline void on_unknown(Handler handler) noexcept { fallback_ = handler; }
+
+    // Indexes all added handlers; they become visible to calls only after this.
+    void build() {
+        std::vector<const char*> names(names_.size());
+        std::vector<mhash_handler> handlers(handlers_.size());
+        for (size_t i = 0; i < names_.size(); ++i) {
+            names[i] = names_[i].c_str();
+            handlers[i] = reinterpret_cast<mhash_handler>(reinterpret_cast<void (*)()>(handlers_[i]));
+        }
+        release();
+        if (mhash_dispatch_init(&dispatch_, names.data(), handlers.data(), names.size(), flags_) != MHASH_OK)
+            throw std::runtime_error("Failed to build dispatcher: either too many collisions, too many keys, or duplicate keys.");
+    }
+
+    // Handler of name, or nullptr.
+    inline Handler find(std::string_view name) const noexcept {
+        const MHashDispatchRecord* r = mhash_dispatch_find(&dispatch_, name.data(), name.size());
+        return r ? reinterpret_cast<Handler>(reinterpret_cast<void (*)()>(r->handler)) : nullptr;
+    }
+
+    inline R operator()(std::string_view name, Args... args) const {
+        const MHashDispatchRecord* r = mhash_dispatch_find(&dispatch_, name.data(), name.size());
+        if (r) [[likely]]
+            return reinterpret_cast<Handler>(reinterpret_cast<void (*)()>(r->handler))(std::forward<Args>(args)...);
+        if (fallback_)
+            return fallback_(std::forward<Args>(args)...);
+        return R();
+    }
+
+    inline size_t size() const noexcept { return dispatch_.count; }
+};
+
 #endif // MHASH_MAP_H
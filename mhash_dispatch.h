@@ -0,0 +1,270 @@
+/*
+ * Copyright 2025 Emmanouil Krasanakis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MHASH_DISPATCH_H
+#define MHASH_DISPATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "mhash.h"
+#include "mhash_str.h"
+#include "mhash_alloc.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Name-to-handler dispatch for command parsers. Every handler is stored in one record
+// together with its name, and table slots hold record offsets, so a dispatch reads one
+// slot and one record before the indirect call. Names are (pointer, length) pairs and
+// need not be NUL-terminated. With MHASH_DISPATCH_NOCASE, ASCII letters match in any case.
+
+#define MHASH_DISPATCH_NOCASE 1
+#define MHASH_DISPATCH_EMPTY UINT32_MAX
+
+typedef int (*mhash_handler)(void *ctx, void *arg);
+
+typedef struct MHashDispatchRecord {
+    mhash_handler handler;
+    uint32_t length;
+    uint32_t id; // position of the name at init
+    // followed by the name (lowercase with MHASH_DISPATCH_NOCASE) and a NUL
+} MHashDispatchRecord;
+
+typedef struct MHashDispatch {
+    uint32_t *table; // record offsets, or MHASH_DISPATCH_EMPTY
+    size_t table_size;
+    MHASH_UINT num_hashes;
+    size_t count;
+    int flags;
+    const unsigned char *records;
+} MHashDispatch;
+
+static inline const char *mhash_dispatch_key(const MHashDispatchRecord *r) {
+    return (const char *)(r + 1);
+}
+
+// mhash_str_prefix over at most len bytes.
+static inline MHASH_UINT mhash__dispatch_level(const char *s, size_t len, MHASH_UINT id) {
+    MHASH_UINT h = 0x9E3779B97F4A7C15ULL * id;
+    if (len > id) len = (size_t)id;
+    for (size_t i = 0; i < len; ++i) {
+        char c = s[i];
+        if (c == 0) break;
+        h ^= (uint64_t)(c + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2));
+    }
+    return h;
+}
+
+// Levels up to 8 fall through with constant ids, so their prefix loops unroll.
+static inline MHASH_UINT mhash__dispatch_concat(MHASH_UINT num_hashes, const char *s, size_t len) {
+    MHASH_UINT combined = 0;
+    switch (num_hashes) {
+    default:
+        for (MHASH_UINT i = 9; i <= num_hashes; ++i)
+            combined ^= mhash__dispatch_level(s, len, i);
+        /* fall through */
+    case 8: combined ^= mhash__dispatch_level(s, len, 8); /* fall through */
+    case 7: combined ^= mhash__dispatch_level(s, len, 7); /* fall through */
+    case 6: combined ^= mhash__dispatch_level(s, len, 6); /* fall through */
+    case 5: combined ^= mhash__dispatch_level(s, len, 5); /* fall through */
+    case 4: combined ^= mhash__dispatch_level(s, len, 4); /* fall through */
+    case 3: combined ^= mhash__dispatch_level(s, len, 3); /* fall through */
+    case 2: combined ^= mhash__dispatch_level(s, len, 2); /* fall through */
+    case 1: combined ^= mhash__dispatch_level(s, len, 1); /* fall through */
+    case 0: break;
+    }
+    return combined;
+}
+
+// Slot of a combined hash with two multiplies instead of a 64-bit division. Prefix hashes
+// of short keys differ mostly in their low bits, so a Fibonacci multiply first moves them up.
+static inline size_t mhash__dispatch_reduce(MHASH_UINT combined, size_t table_size) {
+    const uint64_t mixed = ((uint64_t)combined * 0x9E3779B97F4A7C15ULL) >> 32;
+    return (size_t)((mixed * (uint64_t)table_size) >> 32);
+}
+
+// Lowercases the len <= MHASH_MAX_HASHES bytes at s into out, 16 at a time where possible.
+MHASH_STR_OVERREAD static inline void mhash__dispatch_fold(char *out, const char *s, size_t len) {
+#if defined(__SSE2__)
+    if (MHASH_MAX_HASHES <= 16 && mhash__same_page16(s)) {
+        unsigned char block[16];
+        _mm_storeu_si128((__m128i *)block, mhash_str_fold16(_mm_loadu_si128((const __m128i *)s)));
+        memcpy(out, block, len);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < len; ++i)
+        out[i] = (char)mhash_str_fold((unsigned char)s[i]);
+}
+
+static inline MHASH_UINT mhash__dispatch_pos(const MHashDispatch *d, const char *s, size_t len) {
+    char folded[MHASH_MAX_HASHES];
+    if (d->flags & MHASH_DISPATCH_NOCASE) {
+        // levels read at most num_hashes bytes, so fold those once
+        if (len > d->num_hashes) len = (size_t)d->num_hashes;
+        mhash__dispatch_fold(folded, s, len);
+        s = folded;
+    }
+    return mhash__dispatch_reduce(mhash__dispatch_concat(d->num_hashes, s, len), d->table_size);
+}
+
+// Slot of key i for mhash__search, from the combined hashes precomputed in context.
+static inline size_t mhash__dispatch_slot(const MHashKeySource *keys, size_t i, MHASH_UINT num_hashes, size_t table_size) {
+    const MHASH_UINT *combined = (const MHASH_UINT *)keys->context;
+    return mhash__dispatch_reduce(combined[i * MHASH_MAX_HASHES + num_hashes - 1], table_size);
+}
+
+static inline size_t mhash__dispatch_record_bytes(size_t length) {
+    return (sizeof(MHashDispatchRecord) + length + 1 + 7) & ~(size_t)7;
+}
+
+// Builds the dispatch table in one mhash_alloc block. Names must be NUL-terminated here
+// and distinct (case-insensitively with MHASH_DISPATCH_NOCASE). Release with mhash_dispatch_free.
+static inline int mhash_dispatch_init(MHashDispatch *d,
+                        const char **names,
+                        const mhash_handler *handlers,
+                        size_t count,
+                        int flags) {
+    if (!d || (count && (!names || !handlers)))
+        return MHASH_FAILED;
+    memset(d, 0, sizeof(*d));
+    d->flags = flags;
+    d->count = count;
+    size_t record_bytes = 0;
+    for (size_t i = 0; i < count; ++i)
+        record_bytes += mhash__dispatch_record_bytes(strlen(names[i]));
+    if (record_bytes > UINT32_MAX)
+        return MHASH_FAILED;
+
+    // keys as they are hashed and compared
+    size_t name_bytes = 0;
+    for (size_t i = 0; i < count; ++i)
+        name_bytes += strlen(names[i]) + 1;
+    char *folded = (char *)malloc(name_bytes + 1);
+    const void **keys = (const void **)malloc((count + 1) * sizeof(void *));
+    if (!folded || !keys) {
+        free(folded);
+        free(keys);
+        return MHASH_FAILED;
+    }
+    char *p = folded;
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = p;
+        for (const char *s = names[i];; ++s) {
+            *p++ = (flags & MHASH_DISPATCH_NOCASE) ? (char)mhash_str_fold((unsigned char)*s) : *s;
+            if (!*s) break;
+        }
+    }
+
+    // combined hashes of every key for 1..MHASH_MAX_HASHES levels, placed by mhash__search
+    MHASH_UINT *combined = (MHASH_UINT *)malloc((count * MHASH_MAX_HASHES + 1) * sizeof(MHASH_UINT));
+    MHASH_INDEX_UINT *slots = NULL;
+    MHash ph;
+    int status = MHASH_FAILED;
+    if (combined) {
+        for (size_t i = 0; i < count; ++i) {
+            const size_t length = strlen((const char *)keys[i]);
+            MHASH_UINT h = 0;
+            for (size_t k = 0; k < MHASH_MAX_HASHES; ++k)
+                combined[i * MHASH_MAX_HASHES + k] = h ^= mhash__dispatch_level((const char *)keys[i], length, k + 1);
+        }
+        if (count) {
+            const MHashKeySource source = {NULL, NULL, NULL, mhash__dispatch_slot, combined};
+            status = mhash__search_table_size(&ph, &slots, count, NULL, &source);
+        } else if ((slots = (MHASH_INDEX_UINT *)malloc(sizeof(MHASH_INDEX_UINT)))) {
+            slots[0] = MHASH_EMPTY_SLOT;
+            mhash__setup(&ph, slots, 1, 0, NULL, 0);
+            status = MHASH_OK;
+        }
+    }
+
+    unsigned char *block = NULL;
+    if (status == MHASH_OK)
+        block = (unsigned char *)mhash_alloc(record_bytes + ph.table_size * sizeof(uint32_t));
+    if (block) {
+        // records first so that they stay 8-byte aligned; slots then turn into record offsets
+        size_t offset = 0;
+        uint32_t *offsets = (uint32_t *)combined;
+        for (size_t i = 0; i < count; ++i) {
+            const size_t length = strlen((const char *)keys[i]);
+            MHashDispatchRecord *r = (MHashDispatchRecord *)(block + offset);
+            r->handler = handlers[i];
+            r->length = (uint32_t)length;
+            r->id = (uint32_t)i;
+            memcpy(r + 1, keys[i], length + 1);
+            offsets[i] = (uint32_t)offset;
+            offset += mhash__dispatch_record_bytes(length);
+        }
+        d->records = block;
+        d->table = (uint32_t *)(block + record_bytes);
+        d->table_size = ph.table_size;
+        d->num_hashes = ph.num_hashes;
+        for (size_t i = 0; i < ph.table_size; ++i)
+            d->table[i] = slots[i] == MHASH_EMPTY_SLOT ? MHASH_DISPATCH_EMPTY : offsets[slots[i]];
+    }
+    free(slots);
+    free(combined);
+    free(keys);
+    free(folded);
+    if (!block) {
+        memset(d, 0, sizeof(*d));
+        return MHASH_FAILED;
+    }
+    return MHASH_OK;
+}
+
+static inline void mhash_dispatch_free(MHashDispatch *d) {
+    if (d && d->records)
+        mhash_free((void *)d->records);
+    if (d)
+        memset(d, 0, sizeof(*d));
+}
+
+// Record of the name, or NULL if it is not registered.
+static inline const MHashDispatchRecord *mhash_dispatch_find(const MHashDispatch *d, const char *name, size_t len) {
+    if (!d->table_size)
+        return NULL;
+    const uint32_t offset = d->table[mhash__dispatch_pos(d, name, len)];
+    if (offset == MHASH_DISPATCH_EMPTY)
+        return NULL;
+    const MHashDispatchRecord *r = (const MHashDispatchRecord *)(d->records + offset);
+    if (r->length != len)
+        return NULL;
+    const char *key = mhash_dispatch_key(r);
+    if (d->flags & MHASH_DISPATCH_NOCASE)
+        return mhash_str_equal_nocase(key, name, len) ? r : NULL;
+    return memcmp(key, name, len) ? NULL : r;
+}
+
+// Calls the handler of name with (ctx, arg) and stores its return value in *result (if
+// not NULL). Returns MHASH_FAILED without calling anything for unknown names.
+static inline int mhash_dispatch(const MHashDispatch *d, const char *name, size_t len, void *ctx, void *arg, int *result) {
+    const MHashDispatchRecord *r = mhash_dispatch_find(d, name, len);
+    if (!r)
+        return MHASH_FAILED;
+    const int ret = r->handler(ctx, arg);
+    if (result)
+        *result = ret;
+    return MHASH_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MHASH_DISPATCH_H
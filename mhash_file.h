@@ -0,0 +1,297 @@
+/*
+ * Copyright 2025 Emmanouil Krasanakis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MHASH_FILE_H
+#define MHASH_FILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "mhash.h"
+#include "mhash_str.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MHASH_FILE_VERSION 1
+#define MHASH_FILE_ENDIAN 0x01020304u
+#define MHASH_FILE_ALIGN 64
+
+// Hash families that a file can name; MHASH_FAMILY_CUSTOM files need the function passed to the loader.
+#define MHASH_FAMILY_CUSTOM 0
+#define MHASH_FAMILY_STR_PREFIX 1
+#define MHASH_FAMILY_STR_ALL 2
+
+// All offsets are in bytes from the start of the file, and all sections are 64-byte aligned.
+// A plain MHash is stored as a single shard with shard_bits = 0.
+typedef struct MHashFileHeader {
+    char magic[8];               // "MHASHMAP"
+    uint32_t version;
+    uint32_t endian;             // MHASH_FILE_ENDIAN as written by the producer
+    uint32_t slot_width;         // sizeof(MHASH_INDEX_UINT)
+    uint32_t hash_width;         // sizeof(MHASH_UINT)
+    uint32_t family;             // MHASH_FAMILY_*
+    uint32_t shard_bits;
+    uint64_t seed;               // reserved for seeded families, 0 for mhash_str.h
+    uint64_t value_size;
+    uint64_t count;
+    uint64_t num_shards;
+    uint64_t table_size;         // total slots across shards
+    uint64_t shards_offset;      // MHashFileShard[num_shards]
+    uint64_t table_offset;       // MHASH_INDEX_UINT[table_size]
+    uint64_t key_offsets_offset; // uint64_t[count + 1] into the key pool
+    uint64_t key_pool_offset;    // NUL-terminated keys
+    uint64_t values_offset;      // count values of value_size bytes
+    uint64_t file_size;
+} MHashFileHeader;
+
+typedef struct MHashFileShard {
+    uint64_t table_offset;       // first slot of the shard in the table
+    uint64_t entry_offset;       // first entry of the shard in keys and values
+    uint64_t table_size;
+    uint64_t num_hashes;
+} MHashFileShard;
+
+typedef struct MHashFile {
+    const MHashFileHeader *header;
+    const MHashFileShard *shards;
+    const MHASH_INDEX_UINT *table;
+    const uint64_t *key_offsets;
+    const char *key_pool;
+    const char *values;
+    uint64_t key_pool_size;
+    mhash_func hash_func;
+    void *mapping;
+    size_t mapping_size;
+} MHashFile;
+
+static inline mhash_func mhash_family_func(uint32_t family) {
+    switch (family) {
+        case MHASH_FAMILY_STR_PREFIX: return mhash_str_prefix;
+        case MHASH_FAMILY_STR_ALL: return mhash_str_all;
+        default: return NULL;
+    }
+}
+
+static inline uint64_t mhash__file_align(uint64_t offset) {
+    return (offset + MHASH_FILE_ALIGN - 1) & ~(uint64_t)(MHASH_FILE_ALIGN - 1);
+}
+
+// Whether count items of item_size bytes at offset are aligned and lie within file_size bytes.
+static inline int mhash__file_section(uint64_t offset, uint64_t count, uint64_t item_size, uint64_t file_size) {
+    if (offset % MHASH_FILE_ALIGN || offset > file_size)
+        return 0;
+    return item_size == 0 || count <= (file_size - offset) / item_size;
+}
+
+// Checks that every section and shard of a mapped file lies within its size bytes, so that
+// lookups never read outside the mapping. Costs O(num_shards), not O(count).
+static inline int mhash__file_valid(const MHashFileHeader *h, const char *base, uint64_t size) {
+    if (h->shard_bits >= 64 || h->num_shards != ((uint64_t)1 << h->shard_bits) || h->count == UINT64_MAX
+            || !mhash__file_section(h->shards_offset, h->num_shards, sizeof(MHashFileShard), size)
+            || !mhash__file_section(h->table_offset, h->table_size, sizeof(MHASH_INDEX_UINT), size)
+            || !mhash__file_section(h->key_offsets_offset, h->count + 1, sizeof(uint64_t), size)
+            || !mhash__file_section(h->key_pool_offset, 0, 1, size)
+            || !mhash__file_section(h->values_offset, h->count, h->value_size, size))
+        return 0;
+    // keys are read with strcmp, so the pool must end with a NUL
+    const uint64_t pool_size = ((const uint64_t *)(base + h->key_offsets_offset))[h->count];
+    if (pool_size > size - h->key_pool_offset || (h->count && (!pool_size || base[h->key_pool_offset + pool_size - 1])))
+        return 0;
+    const MHashFileShard *shards = (const MHashFileShard *)(base + h->shards_offset);
+    for (uint64_t i = 0; i < h->num_shards; ++i)
+        if (shards[i].table_size == 0 || shards[i].table_offset > h->table_size
+                || shards[i].table_size > h->table_size - shards[i].table_offset
+                || shards[i].entry_offset > h->count || shards[i].num_hashes > MHASH_MAX_HASHES)
+            return 0;
+    return 1;
+}
+
+static inline int mhash__file_put(FILE *out, uint64_t *at, uint64_t offset, const void *data, size_t bytes) {
+    static const char zeros[MHASH_FILE_ALIGN] = {0};
+    if (offset - *at > MHASH_FILE_ALIGN || fwrite(zeros, 1, (size_t)(offset - *at), out) != offset - *at)
+        return MHASH_FAILED;
+    if (bytes && fwrite(data, 1, bytes, out) != bytes)
+        return MHASH_FAILED;
+    *at = offset + bytes;
+    return MHASH_OK;
+}
+
+// Writes shards built over one table to a stream. keys[i] and the value at
+// values + i * value_size belong to entry i, and shards refer to entries and slots by offset.
+static inline int mhash_file_write_stream(FILE *out,
+                        uint32_t family,
+                        uint32_t shard_bits,
+                        const MHashFileShard *shards,
+                        size_t num_shards,
+                        const MHASH_INDEX_UINT *table,
+                        size_t table_size,
+                        const char *const *keys,
+                        size_t count,
+                        const void *values,
+                        size_t value_size) {
+    MHashFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "MHASHMAP", 8);
+    h.version = MHASH_FILE_VERSION;
+    h.endian = MHASH_FILE_ENDIAN;
+    h.slot_width = sizeof(MHASH_INDEX_UINT);
+    h.hash_width = sizeof(MHASH_UINT);
+    h.family = family;
+    h.shard_bits = shard_bits;
+    h.value_size = value_size;
+    h.count = count;
+    h.num_shards = num_shards;
+    h.table_size = table_size;
+    uint64_t key_pool_size = 0;
+    for (size_t i = 0; i < count; ++i)
+        key_pool_size += strlen(keys[i]) + 1;
+    h.shards_offset = mhash__file_align(sizeof(h));
+    h.table_offset = mhash__file_align(h.shards_offset + num_shards * sizeof(MHashFileShard));
+    h.key_offsets_offset = mhash__file_align(h.table_offset + table_size * sizeof(MHASH_INDEX_UINT));
+    h.key_pool_offset = mhash__file_align(h.key_offsets_offset + (count + 1) * sizeof(uint64_t));
+    h.values_offset = mhash__file_align(h.key_pool_offset + key_pool_size);
+    h.file_size = h.values_offset + count * value_size;
+
+    uint64_t at = 0;
+    int status = mhash__file_put(out, &at, 0, &h, sizeof(h));
+    if (!status)
+        status = mhash__file_put(out, &at, h.shards_offset, shards, num_shards * sizeof(MHashFileShard));
+    if (!status)
+        status = mhash__file_put(out, &at, h.table_offset, table, table_size * sizeof(MHASH_INDEX_UINT));
+    uint64_t offset = 0;
+    for (size_t i = 0; !status && i <= count; ++i) {
+        status = mhash__file_put(out, &at, i ? at : h.key_offsets_offset, &offset, sizeof(offset));
+        if (i < count) offset += strlen(keys[i]) + 1;
+    }
+    for (size_t i = 0; !status && i < count; ++i)
+        status = mhash__file_put(out, &at, i ? at : h.key_pool_offset, keys[i], strlen(keys[i]) + 1);
+    if (!status)
+        status = mhash__file_put(out, &at, h.values_offset, values, count * value_size);
+    return status;
+}
+
+static inline int mhash_file_write_sharded(const char *path,
+                        uint32_t family,
+                        uint32_t shard_bits,
+                        const MHashFileShard *shards,
+                        size_t num_shards,
+                        const MHASH_INDEX_UINT *table,
+                        size_t table_size,
+                        const char *const *keys,
+                        size_t count,
+                        const void *values,
+                        size_t value_size) {
+    FILE *out = fopen(path, "wb");
+    if (!out)
+        return MHASH_FAILED;
+    int status = mhash_file_write_stream(out, family, shard_bits, shards, num_shards, table, table_size,
+                                         keys, count, values, value_size);
+    if (fclose(out))
+        status = MHASH_FAILED;
+    return status;
+}
+
+// Writes a map built with mhash_init over string keys.
+static inline int mhash_file_write(const char *path,
+                        const MHash *ph,
+                        uint32_t family,
+                        const char *const *keys,
+                        const void *values,
+                        size_t value_size) {
+    MHashFileShard shard = {0, 0, ph->table_size, ph->num_hashes};
+    return mhash_file_write_sharded(path, family, 0, &shard, 1, ph->table, ph->table_size,
+                                    keys, ph->count, values, value_size);
+}
+
+// Maps an open file descriptor holding the mhash_file.h format read-only. The descriptor
+// can be closed afterwards. hash_func is only used for MHASH_FAMILY_CUSTOM files.
+static inline int mhash_file_map_fd(MHashFile *f, int fd, mhash_func hash_func) {
+    memset(f, 0, sizeof(*f));
+    struct stat st;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(MHashFileHeader))
+        return MHASH_FAILED;
+    void *mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+        return MHASH_FAILED;
+    const MHashFileHeader *h = (const MHashFileHeader *)mapping;
+    const char *base = (const char *)mapping;
+    f->mapping = mapping;
+    f->mapping_size = (size_t)st.st_size;
+    f->hash_func = h->family == MHASH_FAMILY_CUSTOM ? hash_func : mhash_family_func(h->family);
+    if (memcmp(h->magic, "MHASHMAP", 8) || h->version != MHASH_FILE_VERSION
+            || h->endian != MHASH_FILE_ENDIAN
+            || h->slot_width != sizeof(MHASH_INDEX_UINT) || h->hash_width != sizeof(MHASH_UINT)
+            || h->file_size > (uint64_t)st.st_size || !f->hash_func
+            || !mhash__file_valid(h, base, (uint64_t)st.st_size)) {
+        munmap(mapping, f->mapping_size);
+        memset(f, 0, sizeof(*f));
+        return MHASH_FAILED;
+    }
+    f->header = h;
+    f->shards = (const MHashFileShard *)(base + h->shards_offset);
+    f->table = (const MHASH_INDEX_UINT *)(base + h->table_offset);
+    f->key_offsets = (const uint64_t *)(base + h->key_offsets_offset);
+    f->key_pool = base + h->key_pool_offset;
+    f->values = base + h->values_offset;
+    f->key_pool_size = f->key_offsets[h->count];
+    return MHASH_OK;
+}
+
+// Maps a file written by mhash_file_write(_sharded) read-only; lookups are then served
+// straight from the mapping.
+static inline int mhash_file_open(MHashFile *f, const char *path, mhash_func hash_func) {
+    memset(f, 0, sizeof(*f));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return MHASH_FAILED;
+    int status = mhash_file_map_fd(f, fd, hash_func);
+    close(fd);
+    return status;
+}
+
+static inline void mhash_file_close(MHashFile *f) {
+    if (f->mapping)
+        munmap(f->mapping, f->mapping_size);
+    memset(f, 0, sizeof(*f));
+}
+
+// Returns the value of a key, or NULL if it is missing.
+static inline const void *mhash_file_get(const MHashFile *f, const char *key) {
+    const MHashFileShard *shard = &f->shards[mhash_str_shard(key, f->header->shard_bits)];
+    MHASH_UINT pos = mhash__concat(f->hash_func, (MHASH_UINT)shard->num_hashes, key) % (MHASH_UINT)shard->table_size;
+    MHASH_INDEX_UINT entry = f->table[shard->table_offset + pos];
+    if (entry == MHASH_EMPTY_SLOT)
+        return NULL;
+    uint64_t idx = shard->entry_offset + entry;
+    // bounds a corrupt table or key offset to the mapped sections
+    if (idx >= f->header->count || f->key_offsets[idx] >= f->key_pool_size
+            || strcmp(f->key_pool + f->key_offsets[idx], key))
+        return NULL;
+    return f->values + idx * f->header->value_size;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MHASH_FILE_H
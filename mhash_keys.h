@@ -0,0 +1,100 @@
+#ifndef MHASH_KEYS_H
+#define MHASH_KEYS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// Front-coded key store for verifying lookups in very large dictionaries. Keys are sorted
+// and cut into blocks; the first key of each block is stored whole and every other key
+// as (shared prefix length, suffix). Looking up id decodes only its own block, up to the
+// key itself. Ids are the positions of keys at construction, so the perfect-hash table
+// and values stay as they are; the id-to-rank array is dropped when keys arrive sorted.
+class MHashFrontCodedKeys {
+    std::vector<uint8_t> data_;
+    std::vector<uint64_t> block_offsets_;
+    std::vector<uint32_t> rank_; // empty when ids are already ranks
+    size_t block_size_ = 16;
+    size_t count_ = 0;
+
+    static inline void put_varint(std::vector<uint8_t>& out, size_t v) {
+        while (v >= 0x80) {
+            out.push_back(uint8_t(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(uint8_t(v));
+    }
+    static inline size_t get_varint(const uint8_t*& p) noexcept {
+        size_t v = 0;
+        for (unsigned shift = 0;; shift += 7) {
+            const uint8_t b = *p++;
+            v |= size_t(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+    }
+public:
+    MHashFrontCodedKeys() = default;
+    MHashFrontCodedKeys(const char* const* keys, size_t count, size_t block_size = 16)
+        : block_size_(block_size ? block_size : 1), count_(count) {
+        std::vector<uint32_t> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        auto less = [&](uint32_t a, uint32_t b) { return std::strcmp(keys[a], keys[b]) < 0; };
+        if (!std::is_sorted(order.begin(), order.end(), less)) {
+            std::sort(order.begin(), order.end(), less);
+            rank_.resize(count);
+            for (size_t r = 0; r < count; ++r)
+                rank_[order[r]] = (uint32_t)r;
+        }
+        const char* previous = "";
+        for (size_t r = 0; r < count; ++r) {
+            const char* key = keys[order[r]];
+            const size_t len = std::strlen(key);
+            size_t shared = 0;
+            if (r % block_size_ == 0) block_offsets_.push_back(data_.size());
+            else while (previous[shared] && previous[shared] == key[shared]) ++shared;
+            put_varint(data_, shared);
+            put_varint(data_, len - shared);
+            data_.insert(data_.end(), key + shared, key + len);
+            previous = key;
+        }
+        data_.shrink_to_fit();
+    }
+
+    inline size_t size() const noexcept { return count_; }
+    inline size_t bytes() const noexcept {
+        return data_.size() + block_offsets_.size() * sizeof(uint64_t) + rank_.size() * sizeof(uint32_t);
+    }
+
+    // Decodes the key with the given id into out.
+    void decode(size_t id, std::string& out) const {
+        const size_t r = rank_.empty() ? id : rank_[id];
+        const uint8_t* p = data_.data() + block_offsets_[r / block_size_];
+        out.clear();
+        for (size_t i = 0, target = r % block_size_;; ++i) {
+            const size_t shared = get_varint(p);
+            const size_t suffix = get_varint(p);
+            out.resize(shared);
+            out.append((const char*)p, suffix);
+            if (i == target) return;
+            p += suffix;
+        }
+    }
+
+    inline std::string key(size_t id) const {
+        std::string out;
+        decode(id, out);
+        return out;
+    }
+
+    // Compares the key with the given id against s without allocating.
+    bool equals(size_t id, const char* s) const {
+        thread_local std::string buffer;
+        decode(id, buffer);
+        return std::strcmp(buffer.c_str(), s) == 0;
+    }
+};
+
+#endif // MHASH_KEYS_H
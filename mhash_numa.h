@@ -0,0 +1,97 @@
+#ifndef MHASH_NUMA_H
+#define MHASH_NUMA_H
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#ifdef MHASH_NUMA
+// link with -lnuma
+#include <numa.h>
+#include <sched.h>
+#endif
+
+// Node-local copies of read-only buffers. Without MHASH_NUMA, or when libnuma reports
+// that the system has no NUMA support, there is a single node and nothing is copied.
+class MHashNumaReplicas {
+    struct Block {
+        void* memory;
+        size_t bytes;
+        bool numa; // from numa_alloc_onnode rather than operator new
+    };
+    std::vector<Block> blocks_;
+    std::vector<int> cpu_node_;
+    int num_nodes_ = 1;
+public:
+    MHashNumaReplicas() {
+#ifdef MHASH_NUMA
+        if (numa_available() < 0) return;
+        num_nodes_ = numa_max_node() + 1;
+        const int num_cpus = numa_num_configured_cpus();
+        cpu_node_.resize(num_cpus > 0 ? num_cpus : 0, 0);
+        for (int cpu = 0; cpu < num_cpus; ++cpu) {
+            const int node = numa_node_of_cpu(cpu);
+            cpu_node_[cpu] = node >= 0 ? node : 0;
+        }
+#endif
+    }
+    MHashNumaReplicas(const MHashNumaReplicas&) = delete;
+    MHashNumaReplicas& operator=(const MHashNumaReplicas&) = delete;
+    MHashNumaReplicas(MHashNumaReplicas&& o) noexcept
+        : blocks_(std::move(o.blocks_)), cpu_node_(std::move(o.cpu_node_)), num_nodes_(o.num_nodes_) {
+        o.blocks_.clear();
+    }
+    MHashNumaReplicas& operator=(MHashNumaReplicas&& o) noexcept {
+        if (this != &o) {
+            clear();
+            blocks_ = std::move(o.blocks_);
+            cpu_node_ = std::move(o.cpu_node_);
+            num_nodes_ = o.num_nodes_;
+            o.blocks_.clear();
+        }
+        return *this;
+    }
+    ~MHashNumaReplicas() { clear(); }
+
+    inline int num_nodes() const noexcept { return num_nodes_; }
+
+    // Node of the calling CPU; 0 if unknown.
+    inline int current_node() const noexcept {
+#ifdef MHASH_NUMA
+        const int cpu = sched_getcpu();
+        if (cpu >= 0 && (size_t)cpu < cpu_node_.size())
+            return cpu_node_[cpu];
+#endif
+        return 0;
+    }
+
+    // Copies bytes from src into memory allocated on the given node; freed by clear(). If the
+    // node is out of memory, the copy comes from operator new instead and is read remotely.
+    void* copy(const void* src, size_t bytes, int node) {
+        const size_t size = bytes ? bytes : 1;
+        void* memory = nullptr;
+#ifdef MHASH_NUMA
+        if (num_nodes_ > 1) memory = numa_alloc_onnode(size, node);
+#else
+        (void)node;
+#endif
+        const bool numa = memory != nullptr;
+        if (!memory) memory = ::operator new(size);
+        if (bytes) std::memcpy(memory, src, bytes);
+        blocks_.push_back({memory, size, numa});
+        return memory;
+    }
+
+    void clear() noexcept {
+        for (const Block& b : blocks_) {
+#ifdef MHASH_NUMA
+            if (b.numa) { numa_free(b.memory, b.bytes); continue; }
+#endif
+            ::operator delete(b.memory);
+        }
+        blocks_.clear();
+    }
+};
+
+#endif // MHASH_NUMA_H
@@ -0,0 +1,413 @@
+#ifndef MHASH_SHARD_H
+#define MHASH_SHARD_H
+
+#include "mhash.h"
+#include "mhash_str.h"
+#include "mhash_cpp.h"
+#include "mhash_numa.h"
+#include "mhash_file.h"
+#include "mhash_shm.h"
+#include "mhash_keys.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Splits keys into many small shards by the top bits of a cheap full-key hash and builds
+// an independent small MHash for each shard, so that lookups remain a shard read plus a
+// slot read no matter how many keys there are. Keys are kept in one contiguous pool,
+// or front-coded after compress_keys().
+template<typename ValueType>
+class MHashShardedMap {
+    struct Shard {
+        size_t table_offset;
+        size_t entry_offset;
+        size_t table_size;
+        MHASH_UINT num_hashes;
+    };
+    // lookups go through views, one per NUMA node once replicated
+    struct View {
+        const Shard* shards;
+        const MHASH_INDEX_UINT* table;
+        const char* key_pool; // null when keys are compressed
+        const size_t* key_offsets;
+        ValueType* values;
+    };
+    template<typename T>
+    using Array = std::vector<T, MHashAllocator<T>>;
+    Array<Shard> shards_;
+    Array<MHASH_INDEX_UINT> table_;
+    Array<char> key_pool_;
+    Array<size_t> key_offsets_;
+    Array<ValueType> values_;
+    MHashFrontCodedKeys compressed_keys_;
+    size_t key_block_size_ = 0; // 0 while keys are uncompressed
+    std::vector<View> views_;
+    MHashNumaReplicas replicas_;
+    unsigned shard_bits_ = 0;
+    mhash_func hash_func_;
+    size_t keys_per_shard_;
+    MHASH_UINT max_hashes_;
+    // staging before build
+    std::vector<std::string> staged_keys_;
+    std::vector<ValueType> staged_values_;
+public:
+    explicit MHashShardedMap(size_t keys_per_shard = 8,
+                             MHASH_UINT max_hashes = 2,
+                             mhash_func hash_func = mhash_str_all)
+        : hash_func_(hash_func),
+          keys_per_shard_(keys_per_shard ? keys_per_shard : 1),
+          max_hashes_(max_hashes ? max_hashes : 1) {}
+    MHashShardedMap(const MHashShardedMap&) = delete;
+    MHashShardedMap& operator=(const MHashShardedMap&) = delete;
+    MHashShardedMap(MHashShardedMap&&) noexcept = default;
+    MHashShardedMap& operator=(MHashShardedMap&&) noexcept = default;
+
+    inline void insert(const std::string& key, const ValueType& value) {
+        staged_keys_.push_back(key);
+        staged_values_.push_back(value);
+    }
+
+    inline ValueType* get(const std::string& key) {
+        if (views_.empty()) [[unlikely]]
+            return nullptr;
+        const View& view = views_.size() == 1 ? views_[0] : views_[replicas_.current_node()];
+        const char* s = key.c_str();
+        const Shard& shard = view.shards[mhash_str_shard(s, shard_bits_)];
+        const MHASH_UINT pos = mhash__concat(hash_func_, shard.num_hashes, s) % (MHASH_UINT)shard.table_size;
+        const MHASH_INDEX_UINT local = view.table[shard.table_offset + pos];
+        if (local == MHASH_EMPTY_SLOT) [[unlikely]]
+            return nullptr;
+        const size_t idx = shard.entry_offset + local;
+        if (view.key_pool ? std::strcmp(view.key_pool + view.key_offsets[idx], s) != 0
+                          : !compressed_keys_.equals(idx, s)) [[unlikely]]
+            return nullptr;
+        return &view.values[idx];
+    }
+
+    inline const ValueType* get(const std::string& key) const {
+        return const_cast<MHashShardedMap*>(this)->get(key);
+    }
+
+    inline size_t size() const noexcept { return values_.size(); }
+    inline bool empty() const noexcept { return values_.empty(); }
+    inline size_t num_shards() const noexcept { return shards_.size(); }
+    inline size_t table_size() const noexcept { return table_.size(); }
+    inline size_t num_replicas() const noexcept { return views_.size(); }
+    // bytes spent on keys for verification (pool and offsets, or the front-coded store)
+    inline size_t key_bytes() const noexcept {
+        return key_block_size_ ? compressed_keys_.bytes() : key_pool_.size() + key_offsets_.size() * sizeof(size_t);
+    }
+
+    // Opt-in for very large dictionaries of long keys with shared prefixes (URLs, paths):
+    // replaces the key pool with front-coded blocks of block_size sorted keys. Only the
+    // verification of a hit decodes anything, at most one block. Later builds keep the
+    // keys compressed; replicas made by replicate_numa() share the single compressed copy.
+    void compress_keys(size_t block_size = 16) {
+        std::vector<std::string> decoded;
+        std::vector<const char*> keys = entry_keys(decoded);
+        key_block_size_ = block_size ? block_size : 1;
+        if (keys.empty()) return;
+        compressed_keys_ = MHashFrontCodedKeys(keys.data(), keys.size(), key_block_size_);
+        Array<char>().swap(key_pool_);
+        Array<size_t>().swap(key_offsets_);
+        for (View& view : views_) {
+            view.key_pool = nullptr;
+            view.key_offsets = nullptr;
+        }
+    }
+
+    // Writes the built map in the mhash_file.h format, to be served by MHashMappedMap.
+    // The family defaults to the matching mhash_str.h function, or MHASH_FAMILY_CUSTOM.
+    void save(const std::string& path, int family = -1) const {
+        if (!write_layout(family, [&](auto&&... args) { return mhash_file_write_sharded(path.c_str(), args...); }))
+            throw std::runtime_error("Failed to save map: " + path);
+    }
+
+    // Publishes the built map to POSIX shared memory as a new generation under `name`
+    // (e.g. "/catalog"), to be attached by MHashSharedMap in other processes.
+    void publish_shm(const std::string& name, int family = -1) const {
+        if (!write_layout(family, [&](auto&&... args) { return mhash_shm_publish(name.c_str(), args...); }))
+            throw std::runtime_error("Failed to publish map: " + name);
+    }
+
+    // num_hashes is the largest among shards
+    MHashBuildStats stats() const noexcept {
+        MHASH_UINT num_hashes = 0;
+        for (const Shard& shard : shards_)
+            num_hashes = std::max(num_hashes, shard.num_hashes);
+        return {table_.size(), num_hashes, mhash_vector_backing(table_), mhash_vector_backing(values_)};
+    }
+
+    // Opt-in for multi-socket servers (compile with MHASH_NUMA and link libnuma): copies the
+    // built shards, table, keys and values to every NUMA node so that get() reads the copy
+    // local to the calling CPU. Values become per-node copies too, so writes through get()
+    // only reach the caller's node. Does nothing on single-node systems; the next build()
+    // drops the replicas.
+    void replicate_numa() {
+        static_assert(std::is_trivially_copyable_v<ValueType>, "NUMA replication copies values bytewise");
+        if (values_.empty() || replicas_.num_nodes() <= 1) return;
+        std::vector<View> views(replicas_.num_nodes());
+        for (int node = 0; node < replicas_.num_nodes(); ++node) {
+            views[node].shards = (const Shard*)replicas_.copy(shards_.data(), shards_.size() * sizeof(Shard), node);
+            views[node].table = (const MHASH_INDEX_UINT*)replicas_.copy(table_.data(), table_.size() * sizeof(MHASH_INDEX_UINT), node);
+            if (!key_block_size_) {
+                views[node].key_pool = (const char*)replicas_.copy(key_pool_.data(), key_pool_.size(), node);
+                views[node].key_offsets = (const size_t*)replicas_.copy(key_offsets_.data(), key_offsets_.size() * sizeof(size_t), node);
+            }
+            views[node].values = (ValueType*)replicas_.copy(values_.data(), values_.size() * sizeof(ValueType), node);
+        }
+        views_ = std::move(views);
+    }
+
+    void build(unsigned num_threads = std::thread::hardware_concurrency()) {
+        if (staged_keys_.empty()) return;
+        const size_t old_count = values_.size();
+        const size_t n = old_count + staged_keys_.size();
+
+        std::vector<std::string> decoded;
+        std::vector<const char*> keys = entry_keys(decoded);
+        keys.resize(n);
+        for (size_t i = old_count; i < n; ++i)
+            keys[i] = staged_keys_[i - old_count].c_str();
+
+        // bucket keys per shard with a stable counting sort
+        unsigned shard_bits = 0;
+        while ((keys_per_shard_ << shard_bits) < n && shard_bits < 32)
+            ++shard_bits;
+        const size_t num_shards = size_t(1) << shard_bits;
+        std::vector<uint32_t> shard_ids(n);
+        std::vector<size_t> starts(num_shards + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            shard_ids[i] = (uint32_t)mhash_str_shard(keys[i], shard_bits);
+            ++starts[shard_ids[i] + 1];
+        }
+        for (size_t s = 0; s < num_shards; ++s)
+            starts[s + 1] += starts[s];
+        std::vector<size_t> order(n);
+        {
+            std::vector<size_t> next(starts.begin(), starts.end() - 1);
+            for (size_t i = 0; i < n; ++i)
+                order[next[shard_ids[i]]++] = i;
+        }
+
+        // the new layout is built aside and only swapped in once every shard is placed, so a
+        // failed build leaves the map and the staged inserts as they were
+        Array<char> key_pool;
+        Array<size_t> key_offsets(n);
+        for (size_t j = 0; j < n; ++j) {
+            const size_t i = order[j];
+            key_offsets[j] = key_pool.size();
+            key_pool.insert(key_pool.end(), keys[i], keys[i] + std::strlen(keys[i]) + 1);
+        }
+        keys.clear();
+        keys.shrink_to_fit();
+        std::vector<std::string>().swap(decoded);
+
+        // place every shard independently, then concatenate the shard tables
+        Array<Shard> shards(num_shards);
+        std::vector<std::vector<MHASH_INDEX_UINT>> shard_tables(num_shards);
+        std::atomic<size_t> next_shard{0};
+        std::atomic<bool> failed{false};
+        auto worker = [&]() {
+            std::vector<const void*> shard_keys;
+            for (size_t s; !failed.load(std::memory_order_relaxed) && (s = next_shard.fetch_add(1)) < num_shards;) {
+                const size_t begin = starts[s], count = starts[s + 1] - begin;
+                shard_keys.resize(count);
+                for (size_t i = 0; i < count; ++i)
+                    shard_keys[i] = key_pool.data() + key_offsets[begin + i];
+                shards[s].entry_offset = begin;
+                if (!place(shard_tables[s], shards[s], shard_keys.data(), count))
+                    failed.store(true);
+            }
+        };
+        if (num_threads <= 1) worker();
+        else {
+            std::vector<std::thread> threads;
+            for (unsigned t = 0; t < num_threads; ++t)
+                threads.emplace_back(worker);
+            for (auto& t : threads)
+                t.join();
+        }
+        if (failed)
+            throw std::runtime_error("Failed to build map: either too many collisions, too many keys, or duplicate keys.");
+
+        size_t total_table_size = 0;
+        for (size_t s = 0; s < num_shards; ++s) {
+            shards[s].table_offset = total_table_size;
+            total_table_size += shard_tables[s].size();
+        }
+        Array<MHASH_INDEX_UINT> table;
+        table.reserve(total_table_size);
+        for (auto& t : shard_tables)
+            table.insert(table.end(), t.begin(), t.end());
+        std::vector<std::vector<MHASH_INDEX_UINT>>().swap(shard_tables);
+
+        Array<ValueType> values;
+        values.reserve(n);
+        for (size_t j = 0; j < n; ++j) {
+            const size_t i = order[j];
+            values.push_back(i < old_count ? std::move(values_[i]) : std::move(staged_values_[i - old_count]));
+        }
+        staged_keys_.clear();
+        staged_values_.clear();
+
+        shard_bits_ = shard_bits;
+        shards_ = std::move(shards);
+        table_ = std::move(table);
+        key_pool_ = std::move(key_pool);
+        key_offsets_ = std::move(key_offsets);
+        values_ = std::move(values);
+        views_.assign(1, {shards_.data(), table_.data(), key_pool_.data(), key_offsets_.data(), values_.data()});
+        replicas_.clear();
+        // the new entries are in the pool now, so recompress from there
+        if (const size_t block_size = std::exchange(key_block_size_, 0))
+            compress_keys(block_size);
+    }
+
+    void clear() {
+        views_.clear();
+        replicas_.clear();
+        shards_.clear();
+        table_.clear();
+        key_pool_.clear();
+        key_offsets_.clear();
+        values_.clear();
+        compressed_keys_ = MHashFrontCodedKeys();
+        staged_keys_.clear();
+        staged_values_.clear();
+        shard_bits_ = 0;
+    }
+
+private:
+    // keys of the built entries in entry order; compressed keys are decoded into storage
+    std::vector<const char*> entry_keys(std::vector<std::string>& storage) const {
+        std::vector<const char*> keys(values_.size());
+        if (key_block_size_) {
+            storage.resize(keys.size());
+            for (size_t i = 0; i < keys.size(); ++i) {
+                compressed_keys_.decode(i, storage[i]);
+                keys[i] = storage[i].c_str();
+            }
+        } else {
+            for (size_t i = 0; i < keys.size(); ++i)
+                keys[i] = key_pool_.data() + key_offsets_[i];
+        }
+        return keys;
+    }
+
+    template<typename Write>
+    bool write_layout(int family, Write write) const {
+        static_assert(std::is_trivially_copyable_v<ValueType>, "saved values are copied bytewise");
+        if (shards_.empty()) return false;
+        if (family < 0)
+            family = hash_func_ == mhash_str_prefix ? MHASH_FAMILY_STR_PREFIX
+                   : hash_func_ == mhash_str_all ? MHASH_FAMILY_STR_ALL : MHASH_FAMILY_CUSTOM;
+        std::vector<MHashFileShard> shards(shards_.size());
+        for (size_t i = 0; i < shards_.size(); ++i)
+            shards[i] = {shards_[i].table_offset, shards_[i].entry_offset, shards_[i].table_size, shards_[i].num_hashes};
+        std::vector<std::string> decoded;
+        std::vector<const char*> keys = entry_keys(decoded);
+        return write((uint32_t)family, (uint32_t)shard_bits_, shards.data(), shards.size(), table_.data(), table_.size(),
+                     keys.data(), keys.size(), (const void*)values_.data(), sizeof(ValueType)) == MHASH_OK;
+    }
+
+    bool place(std::vector<MHASH_INDEX_UINT>& table, Shard& shard, const void** keys, size_t count) const {
+        if (count == 0) {
+            table.assign(1, MHASH_EMPTY_SLOT);
+            shard.table_size = 1;
+            shard.num_hashes = 0;
+            return true;
+        }
+        size_t table_size = count * 2;
+        const size_t max_table_size = 128 * count;
+        MHash mhash;
+        for (;;) {
+            table.assign(table_size, MHASH_EMPTY_SLOT);
+            const int success = (mhash_init(&mhash, table.data(), table_size, keys, count, hash_func_) == MHASH_OK);
+            if (success && mhash.num_hashes <= max_hashes_) break;
+            if (table_size < 16) ++table_size;
+            else table_size = table_size + table_size / 5 + 1;
+            if (table_size > 65536 || table_size > max_table_size) {
+                if (!success) return false;
+                break;
+            }
+        }
+        table.resize(mhash.table_size);
+        shard.table_size = mhash.table_size;
+        shard.num_hashes = mhash.num_hashes;
+        return true;
+    }
+};
+
+// Read-only map served directly from a memory-mapped file written by
+// MHashShardedMap::save or mhash_file_write. Loading is a single mmap with no parsing.
+template<typename ValueType>
+class MHashMappedMap {
+    MHashFile file_{};
+public:
+    explicit MHashMappedMap(const std::string& path, mhash_func hash_func = nullptr) {
+        if (mhash_file_open(&file_, path.c_str(), hash_func) != MHASH_OK)
+            throw std::runtime_error("Failed to load map: " + path);
+        if (file_.header->value_size != sizeof(ValueType)) {
+            mhash_file_close(&file_);
+            throw std::runtime_error("Failed to load map: value size mismatch in " + path);
+        }
+    }
+    MHashMappedMap(const MHashMappedMap&) = delete;
+    MHashMappedMap& operator=(const MHashMappedMap&) = delete;
+    MHashMappedMap(MHashMappedMap&& o) noexcept : file_(o.file_) { o.file_ = {}; }
+    MHashMappedMap& operator=(MHashMappedMap&& o) noexcept {
+        if (this != &o) { mhash_file_close(&file_); file_ = o.file_; o.file_ = {}; }
+        return *this;
+    }
+    ~MHashMappedMap() { mhash_file_close(&file_); }
+
+    inline const ValueType* get(const std::string& key) const {
+        return static_cast<const ValueType*>(mhash_file_get(&file_, key.c_str()));
+    }
+    inline size_t size() const noexcept { return file_.header->count; }
+    inline bool empty() const noexcept { return size() == 0; }
+};
+
+// Read-only view of a map published with MHashShardedMap::publish_shm or mhash_shm_publish.
+// Lookups read the shared segment in place; refresh() switches to the latest generation.
+template<typename ValueType>
+class MHashSharedMap {
+    MHashShmReader reader_{};
+public:
+    explicit MHashSharedMap(const std::string& name, mhash_func hash_func = nullptr) {
+        if (mhash_shm_attach(&reader_, name.c_str(), hash_func) != MHASH_OK)
+            throw std::runtime_error("Failed to attach map: " + name);
+        if (reader_.file.header->value_size != sizeof(ValueType)) {
+            mhash_shm_detach(&reader_);
+            throw std::runtime_error("Failed to attach map: value size mismatch in " + name);
+        }
+    }
+    MHashSharedMap(const MHashSharedMap&) = delete;
+    MHashSharedMap& operator=(const MHashSharedMap&) = delete;
+    ~MHashSharedMap() { mhash_shm_detach(&reader_); }
+
+    // Returns true if a newer generation was mapped. Pointers from get() then dangle.
+    bool refresh() {
+        const uint64_t generation = reader_.generation;
+        if (mhash_shm_refresh(&reader_) != MHASH_OK)
+            throw std::runtime_error("Failed to refresh map: " + std::string(reader_.name));
+        return reader_.generation != generation;
+    }
+
+    inline const ValueType* get(const std::string& key) const {
+        return static_cast<const ValueType*>(mhash_shm_get(&reader_, key.c_str()));
+    }
+    inline uint64_t generation() const noexcept { return reader_.generation; }
+    inline size_t size() const noexcept { return reader_.file.header->count; }
+    inline bool empty() const noexcept { return size() == 0; }
+};
+
+#endif // MHASH_SHARD_H
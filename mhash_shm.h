@@ -0,0 +1,195 @@
+/*
+ * Copyright 2025 Emmanouil Krasanakis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MHASH_SHM_H
+#define MHASH_SHM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "mhash_file.h"
+#include <stdint.h>
+#include <stdio.h>
+
+// Maps published into POSIX shared memory for many reader processes. A map named "/x"
+// lives in segment "/x.<generation>" using the offset-based mhash_file.h layout, so it
+// can be mapped at any address. The small control segment "/x" holds the current
+// generation: publishing writes a new segment, then bumps the generation, then unlinks
+// the previous segment (readers that still map it keep it alive until they refresh).
+
+#define MHASH_SHM_NAME_MAX 256
+#define MHASH_SHM_MAGIC 0x4d48534d43544c31ULL // "MHSMCTL1"
+
+typedef struct MHashShmControl {
+    uint64_t magic;
+    uint64_t generation;
+} MHashShmControl;
+
+typedef struct MHashShmReader {
+    MHashFile file;
+    const MHashShmControl *control;
+    uint64_t generation;
+    mhash_func hash_func;
+    char name[MHASH_SHM_NAME_MAX];
+} MHashShmReader;
+
+// Whether name leaves room in segment names for "." and a 20-digit generation, so that
+// snprintf never truncates two generations to the same segment.
+static inline int mhash__shm_name_fits(const char *name) {
+    return strlen(name) + 24 < MHASH_SHM_NAME_MAX;
+}
+
+static inline void mhash__shm_segment(char *out, const char *name, uint64_t generation) {
+    snprintf(out, MHASH_SHM_NAME_MAX, "%s.%llu", name, (unsigned long long)generation);
+}
+
+static inline MHashShmControl *mhash__shm_control(const char *name, int create) {
+    int fd = shm_open(name, create ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (fd < 0)
+        return NULL;
+    if (create && ftruncate(fd, sizeof(MHashShmControl))) {
+        close(fd);
+        return NULL;
+    }
+    void *p = mmap(NULL, sizeof(MHashShmControl), create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? NULL : (MHashShmControl *)p;
+}
+
+// Publishes a new generation of the map; arguments match mhash_file_write_sharded.
+// Only one process may publish a given name at a time.
+static inline int mhash_shm_publish(const char *name,
+                        uint32_t family,
+                        uint32_t shard_bits,
+                        const MHashFileShard *shards,
+                        size_t num_shards,
+                        const MHASH_INDEX_UINT *table,
+                        size_t table_size,
+                        const char *const *keys,
+                        size_t count,
+                        const void *values,
+                        size_t value_size) {
+    if (!mhash__shm_name_fits(name))
+        return MHASH_FAILED;
+    MHashShmControl *control = mhash__shm_control(name, 1);
+    if (!control)
+        return MHASH_FAILED;
+    if (control->magic != MHASH_SHM_MAGIC) {
+        control->generation = 0;
+        __atomic_store_n(&control->magic, MHASH_SHM_MAGIC, __ATOMIC_RELEASE);
+    }
+    const uint64_t previous = __atomic_load_n(&control->generation, __ATOMIC_ACQUIRE);
+    char segment[MHASH_SHM_NAME_MAX];
+    mhash__shm_segment(segment, name, previous + 1);
+    shm_unlink(segment);
+    int fd = shm_open(segment, O_RDWR | O_CREAT | O_EXCL, 0644);
+    FILE *out = fd < 0 ? NULL : fdopen(fd, "wb");
+    if (!out) {
+        if (fd >= 0) close(fd);
+        munmap(control, sizeof(MHashShmControl));
+        return MHASH_FAILED;
+    }
+    int status = mhash_file_write_stream(out, family, shard_bits, shards, num_shards, table, table_size,
+                                         keys, count, values, value_size);
+    if (fclose(out))
+        status = MHASH_FAILED;
+    if (status) {
+        shm_unlink(segment);
+    } else {
+        __atomic_store_n(&control->generation, previous + 1, __ATOMIC_RELEASE);
+        if (previous) {
+            mhash__shm_segment(segment, name, previous);
+            shm_unlink(segment);
+        }
+    }
+    munmap(control, sizeof(MHashShmControl));
+    return status;
+}
+
+// Maps the current generation if it differs from the mapped one. Cheap when nothing
+// changed (one atomic load), so readers can call it before every batch of lookups.
+static inline int mhash_shm_refresh(MHashShmReader *r) {
+    // a publisher may unlink a generation right after we read it, so retry
+    for (int attempt = 0; attempt < 16; ++attempt) {
+        const uint64_t generation = __atomic_load_n(&r->control->generation, __ATOMIC_ACQUIRE);
+        if (generation == r->generation)
+            return r->generation ? MHASH_OK : MHASH_FAILED;
+        char segment[MHASH_SHM_NAME_MAX];
+        mhash__shm_segment(segment, r->name, generation);
+        int fd = shm_open(segment, O_RDONLY, 0);
+        if (fd < 0)
+            continue;
+        MHashFile file;
+        int status = mhash_file_map_fd(&file, fd, r->hash_func);
+        close(fd);
+        if (status)
+            return MHASH_FAILED;
+        mhash_file_close(&r->file);
+        r->file = file;
+        r->generation = generation;
+        return MHASH_OK;
+    }
+    return MHASH_FAILED;
+}
+
+// Attaches read-only to a published map. hash_func is only used for MHASH_FAMILY_CUSTOM maps.
+static inline int mhash_shm_attach(MHashShmReader *r, const char *name, mhash_func hash_func) {
+    memset(r, 0, sizeof(*r));
+    if (!mhash__shm_name_fits(name))
+        return MHASH_FAILED;
+    strcpy(r->name, name);
+    r->hash_func = hash_func;
+    r->control = mhash__shm_control(name, 0);
+    if (!r->control)
+        return MHASH_FAILED;
+    if (__atomic_load_n(&r->control->magic, __ATOMIC_ACQUIRE) != MHASH_SHM_MAGIC || mhash_shm_refresh(r)) {
+        munmap((void *)r->control, sizeof(MHashShmControl));
+        memset(r, 0, sizeof(*r));
+        return MHASH_FAILED;
+    }
+    return MHASH_OK;
+}
+
+static inline void mhash_shm_detach(MHashShmReader *r) {
+    mhash_file_close(&r->file);
+    if (r->control)
+        munmap((void *)r->control, sizeof(MHashShmControl));
+    memset(r, 0, sizeof(*r));
+}
+
+// Looks up the currently mapped generation; returns the value or NULL.
+static inline const void *mhash_shm_get(const MHashShmReader *r, const char *key) {
+    return mhash_file_get(&r->file, key);
+}
+
+// Removes the control segment and the current generation; attached readers keep their mappings.
+static inline void mhash_shm_unlink(const char *name) {
+    MHashShmControl *control = mhash__shm_name_fits(name) ? mhash__shm_control(name, 0) : NULL;
+    if (control) {
+        char segment[MHASH_SHM_NAME_MAX];
+        mhash__shm_segment(segment, name, __atomic_load_n(&control->generation, __ATOMIC_ACQUIRE));
+        shm_unlink(segment);
+        munmap(control, sizeof(MHashShmControl));
+    }
+    shm_unlink(name);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MHASH_SHM_H
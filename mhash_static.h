@@ -0,0 +1,169 @@
+#ifndef MHASH_STATIC_H
+#define MHASH_STATIC_H
+
+#include "mhash.h"
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// constexpr twin of mhash_str_prefix for string_views (also stops at a NUL).
+constexpr MHASH_UINT mhash_str_prefix_sv(std::string_view s, MHASH_UINT id) noexcept {
+    MHASH_UINT h = 0x9E3779B97F4A7C15ULL * id;
+    for (size_t i = 0; i < id && i < s.size(); ++i) {
+        const char c = s[i];
+        if (c == 0) break;
+        h ^= (uint64_t)(c + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2));
+    }
+    return h;
+}
+
+// Perfect-hash map over string keys fixed at compile time. The table, keys and hash
+// parameters are constants, so a static constexpr map lives in .rodata and lookups
+// unroll the hash family with a constant count and table size. Ids are key positions.
+template<size_t N, size_t TableSize, MHASH_UINT NumHashes>
+struct MHashStaticMap {
+    using Index = std::conditional_t<(N < 0xFF), uint8_t, std::conditional_t<(N < 0xFFFF), uint16_t, uint32_t>>;
+    static constexpr Index empty_slot = Index(-1);
+
+    std::array<std::string_view, N> keys;
+    std::array<Index, TableSize> table;
+
+    static constexpr size_t size() noexcept { return N; }
+    static constexpr size_t table_size() noexcept { return TableSize; }
+    static constexpr MHASH_UINT num_hashes() noexcept { return NumHashes; }
+
+    template<typename Key>
+    static constexpr size_t pos(const Key& key) noexcept {
+        return (size_t)(concat(key, std::make_integer_sequence<MHASH_UINT, NumHashes>{}) % (MHASH_UINT)TableSize);
+    }
+
+    // Id of key, or -1 if it is not in the map.
+    constexpr int find(std::string_view key) const noexcept {
+        const Index id = table[pos(key)];
+        return id != empty_slot && keys[id] == key ? (int)id : -1;
+    }
+
+    // Same as find(std::string_view), without measuring the length of key first.
+    constexpr int find(const char* key) const noexcept {
+        const Index id = table[pos(key)];
+        if (id == empty_slot) return -1;
+        const std::string_view k = keys[id];
+        for (size_t i = 0; i < k.size(); ++i)
+            if (key[i] != k[i]) return -1;
+        return key[k.size()] == 0 ? (int)id : -1;
+    }
+
+    constexpr bool contains(std::string_view key) const noexcept { return find(key) >= 0; }
+
+    // Key with the given id, e.g. to turn an enum back into its name.
+    constexpr std::string_view key(size_t id) const noexcept { return keys[id]; }
+
+    // String-to-enum: keys are listed in the order of the enum values 0..N-1.
+    template<typename Enum, typename Key>
+    constexpr std::optional<Enum> to_enum(const Key& key) const noexcept {
+        const int id = find(key);
+        if (id < 0) return std::nullopt;
+        return static_cast<Enum>(id);
+    }
+
+private:
+    template<MHASH_UINT... Ids>
+    static constexpr MHASH_UINT concat(std::string_view s, std::integer_sequence<MHASH_UINT, Ids...>) noexcept {
+        return (MHASH_UINT(0) ^ ... ^ mhash_str_prefix_sv(s, Ids + 1));
+    }
+    // hashes never read past the first NumHashes characters, or past a NUL
+    template<MHASH_UINT... Ids>
+    static constexpr MHASH_UINT concat(const char* s, std::integer_sequence<MHASH_UINT, Ids...> ids) noexcept {
+        size_t length = 0;
+        while (length < NumHashes && s[length]) ++length;
+        return concat(std::string_view(s, length), ids);
+    }
+};
+
+struct MHashStaticParams {
+    size_t table_size;
+    MHASH_UINT num_hashes;
+};
+
+// Combined hash of every key for 1..MHASH_MAX_HASHES hashes, as mhash_init computes them:
+// row h - 1 holds the XOR of the first h hash levels. They do not depend on the table size,
+// so the search computes them once.
+template<size_t N>
+using MHashStaticHashes = std::array<std::array<MHASH_UINT, N>, MHASH_MAX_HASHES>;
+
+template<size_t N>
+consteval MHashStaticHashes<N> mhash_static_hashes(const std::array<std::string_view, N>& keys) {
+    MHashStaticHashes<N> hashes{};
+    for (size_t i = 0; i < N; ++i) {
+        MHASH_UINT combined = 0;
+        for (MHASH_UINT id = 1; id <= MHASH_MAX_HASHES; ++id)
+            hashes[id - 1][i] = combined ^= mhash_str_prefix_sv(keys[i], id);
+    }
+    return hashes;
+}
+
+// Fewest hashes that place all keys in table_size slots without collisions, as mhash_init
+// searches them, or 0 if none up to its worst case does. Each attempt marks the slots it
+// takes, so it costs O(N + table_size) rather than comparing every pair of keys.
+template<size_t N>
+consteval MHASH_UINT mhash_static_try(const MHashStaticHashes<N>& hashes, size_t table_size) {
+    size_t worst_case = MHASH_MAX_HASHES;
+#ifndef MHASH_NO_WORST_CASE
+    if (worst_case > N) worst_case = N;
+#endif
+    for (MHASH_UINT num_hashes = 1; num_hashes <= worst_case; ++num_hashes) {
+        std::vector<bool> taken(table_size);
+        bool ok = true;
+        for (size_t i = 0; i < N && ok; ++i) {
+            const size_t pos = (size_t)(hashes[num_hashes - 1][i] % (MHASH_UINT)table_size);
+            ok = !taken[pos];
+            taken[pos] = true;
+        }
+        if (ok) return num_hashes;
+    }
+    return 0;
+}
+
+// The table size search of MHashMap::build, run by the compiler.
+template<size_t N>
+consteval MHashStaticParams mhash_static_search(const std::array<std::string_view, N>& keys) {
+    const MHashStaticHashes<N> hashes = mhash_static_hashes(keys);
+    size_t table_size = N ? N * 3 : 1;
+    const size_t max_hashes = std::bit_width(N) + 2;
+    const size_t max_table_size = 128 * (N ? N : 1);
+    for (;;) {
+        const MHASH_UINT num_hashes = mhash_static_try(hashes, table_size);
+        if (num_hashes && num_hashes < max_hashes) return {table_size, num_hashes};
+        const size_t next = table_size < 16 ? table_size + 1 : table_size + table_size / 5 + 1;
+        if (next > 65536 || next > max_table_size) {
+            if (!num_hashes) throw "Failed to build map: either too many collisions, too many keys, or duplicate keys.";
+            return {table_size, num_hashes};
+        }
+        table_size = next;
+    }
+}
+
+// Builds a map at compile time from a constexpr lambda returning the keys, e.g.
+//   static constexpr auto methods = mhash_static_map([] {
+//       return std::array<std::string_view, 3>{"GET", "PUT", "POST"};
+//   });
+// A key set that cannot be placed is a compile error.
+template<typename KeysFunc>
+consteval auto mhash_static_map(KeysFunc) {
+    constexpr auto keys = KeysFunc{}();
+    constexpr MHashStaticParams params = mhash_static_search(keys);
+    using Map = MHashStaticMap<keys.size(), params.table_size, params.num_hashes>;
+    Map map{keys, {}};
+    map.table.fill(Map::empty_slot);
+    for (size_t i = 0; i < keys.size(); ++i)
+        map.table[Map::pos(keys[i])] = (typename Map::Index)i;
+    return map;
+}
+
+#endif // MHASH_STATIC_H
@@ -24,6 +24,17 @@ extern "C" {
 #include <string.h>
 #include <stdint.h>
 #include <stdio.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The case-insensitive routines below read whole 16-byte blocks that may extend past
+// the end of a string (never past its page), which AddressSanitizer would report.
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define MHASH_STR_OVERREAD __attribute__((no_sanitize_address))
+#else
+#define MHASH_STR_OVERREAD
+#endif
 
 #ifndef MHASH_UINT
 //#define MHASH_UINT uint16_t
@@ -53,10 +64,184 @@ static inline MHASH_UINT mhash_str_prefix(const void *_s, MHASH_UINT id) {
     return h;
 }
 
+// Cheap full-string hash (FNV-1a) used to pick a shard from its top `bits` bits.
+static inline size_t mhash_str_shard(const void *_s, unsigned bits) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    const unsigned char *s = (const unsigned char *)_s;
+    for (; *s; ++s)
+        h = (h ^ *s) * 0x100000001b3ULL;
+    h *= 0x9E3779B97F4A7C15ULL;
+    return bits ? (size_t)(h >> (64 - bits)) : 0;
+}
+
+// Fingerprint of a key set, for matching an MHashHint to its keys. Slot placement does
+// not depend on the order of the keys, so the fingerprint does not either: it sums a
+// mixed hash of each key.
+static inline uint64_t mhash_str_fingerprint(const void **keys, size_t count) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (const unsigned char *s = (const unsigned char *)keys[i]; *s; ++s)
+            h = (h ^ *s) * 0x100000001b3ULL;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        sum += h ^ (h >> 33);
+    }
+    return sum ^ ((uint64_t)count * 0x9E3779B97F4A7C15ULL);
+}
+
 static inline int mhash_strcmp(const void *a, const void *b) {
     return strcmp((const char *)a, (const char *)b);
 }
 
+// ASCII lowercase of one byte; other bytes are left as they are.
+static inline unsigned char mhash_str_fold(unsigned char c) {
+    return (unsigned char)((unsigned)(c - 'A') < 26u ? c | 0x20 : c);
+}
+
+#if defined(__SSE2__)
+// mhash_str_fold on 16 bytes: 'A'..'Z' shifted to the bottom of the signed range are
+// exactly the bytes below -128 + 26.
+static inline __m128i mhash_str_fold16(__m128i v) {
+    const __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - 'A')));
+    const __m128i upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + 26)));
+    return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+static inline int mhash__same_page16(const void *s) {
+    return ((uintptr_t)s & 4095) <= 4096 - 16;
+}
+#endif
+
+// Continues h over at most limit bytes of the lowercased string s, as mhash_str_prefix does.
+// Bytes are folded 16 at a time.
+MHASH_STR_OVERREAD static inline MHASH_UINT mhash__str_nocase(MHASH_UINT h, const unsigned char *s, size_t limit) {
+#if defined(__SSE2__)
+    while (limit && mhash__same_page16(s)) {
+        const __m128i v = _mm_loadu_si128((const __m128i *)s);
+        const unsigned nul = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+        unsigned char folded[16];
+        _mm_storeu_si128((__m128i *)folded, mhash_str_fold16(v));
+        size_t n = nul ? (size_t)__builtin_ctz(nul) : 16;
+        if (n > limit) n = limit;
+        for (size_t i = 0; i < n; ++i) {
+            char c = (char)folded[i];
+            h ^= (uint64_t)(c + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2));
+        }
+        if (n < 16)
+            return h;
+        s += 16;
+        limit -= 16;
+    }
+#endif
+    for (; limit; --limit, ++s) {
+        char c = (char)mhash_str_fold(*s);
+        if (c == 0) break;
+        h ^= (uint64_t)(c + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2));
+    }
+    return h;
+}
+
+// Case-insensitive mhash_str_prefix: equals mhash_str_prefix of the ASCII-lowercased string,
+// so maps built from lowercase keys with mhash_str_prefix take queries in any case.
+static inline MHASH_UINT mhash_str_prefix_nocase(const void *s, MHASH_UINT id) {
+    return mhash__str_nocase(0x9E3779B97F4A7C15ULL * id, (const unsigned char *)s, (size_t)id);
+}
+
+// Case-insensitive mhash_str_all.
+static inline MHASH_UINT mhash_str_all_nocase(const void *s, MHASH_UINT id) {
+    return mhash__str_nocase(0x9E3779B97F4A7C15ULL * id, (const unsigned char *)s, SIZE_MAX);
+}
+
+// Lowercases s up to its NUL or limit <= 16 bytes into out[16] with one block fold, so that
+// mhash_str_prefix(out, id) == mhash_str_prefix_nocase(s, id) for every id <= limit. Lets
+// callers that evaluate many levels of the same string fold it only once.
+MHASH_STR_OVERREAD static inline void mhash_str_fold_prefix(char *out, const void *s, size_t limit) {
+    const unsigned char *p = (const unsigned char *)s;
+#if defined(__SSE2__)
+    if (mhash__same_page16(p)) {
+        _mm_storeu_si128((__m128i *)out, mhash_str_fold16(_mm_loadu_si128((const __m128i *)p)));
+        return;
+    }
+#endif
+    for (size_t i = 0; i < limit && i < 16; ++i)
+        if ((out[i] = (char)mhash_str_fold(p[i])) == 0)
+            break;
+}
+
+// strcmp of the ASCII-lowercased strings, without lowercasing them into a buffer.
+MHASH_STR_OVERREAD static inline int mhash_strcasecmp(const void *_a, const void *_b) {
+    const unsigned char *a = (const unsigned char *)_a, *b = (const unsigned char *)_b;
+#if defined(__SSE2__)
+    while (mhash__same_page16(a) && mhash__same_page16(b)) {
+        const __m128i va = _mm_loadu_si128((const __m128i *)a);
+        const __m128i vb = _mm_loadu_si128((const __m128i *)b);
+        const unsigned equal = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(mhash_str_fold16(va), mhash_str_fold16(vb)));
+        const unsigned stop = (equal ^ 0xFFFFu) | (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(va, _mm_setzero_si128()));
+        if (stop) {
+            const unsigned i = (unsigned)__builtin_ctz(stop);
+            return (int)mhash_str_fold(a[i]) - (int)mhash_str_fold(b[i]);
+        }
+        a += 16;
+        b += 16;
+    }
+#endif
+    for (;; ++a, ++b) {
+        const int d = (int)mhash_str_fold(*a) - (int)mhash_str_fold(*b);
+        if (d || !*a)
+            return d;
+    }
+}
+
+// Whether the len bytes at a and b are equal up to ASCII letter case.
+MHASH_STR_OVERREAD static inline int mhash_str_equal_nocase(const void *_a, const void *_b, size_t len) {
+    const unsigned char *a = (const unsigned char *)_a, *b = (const unsigned char *)_b;
+#if defined(__SSE2__)
+    for (; len; a += 16, b += 16) {
+        if (len < 16 && !(mhash__same_page16(a) && mhash__same_page16(b)))
+            break;
+        const __m128i va = _mm_loadu_si128((const __m128i *)a);
+        const __m128i vb = _mm_loadu_si128((const __m128i *)b);
+        unsigned differ = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(mhash_str_fold16(va), mhash_str_fold16(vb))) ^ 0xFFFFu;
+        if (len < 16) {
+            differ &= (1u << len) - 1;
+            len = 0;
+        } else {
+            len -= 16;
+        }
+        if (differ)
+            return 0;
+    }
+#endif
+    for (; len; --len, ++a, ++b)
+        if (mhash_str_fold(*a) != mhash_str_fold(*b))
+            return 0;
+    return 1;
+}
+
+// For ascending keys (e.g. of a map built with mhash_init_sorted and mhash_strcmp):
+// sets [*begin, *end) to the ranks of the keys that start with prefix.
+static inline void mhash_str_prefix_range(const void **keys, size_t count, const char *prefix,
+                                          size_t *begin, size_t *end) {
+    const size_t len = strlen(prefix);
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp((const char *)keys[mid], prefix) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    *begin = lo;
+    hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strncmp((const char *)keys[mid], prefix, len) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    *end = lo;
+}
+
 #ifdef __cplusplus
 }
 #endif
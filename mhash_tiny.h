@@ -0,0 +1,240 @@
+/*
+ * Copyright 2025 Emmanouil Krasanakis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MHASH_TINY_H
+#define MHASH_TINY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "mhash.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Compact mode for up to 255 string keys. Keys are hashed with three interleaved 8-bit
+// Pearson lanes over their first `prefix` bytes (the shortest prefix that tells all keys
+// apart). One lane picks a bucket whose one-byte pilot displaces the other two into a
+// uint8 slot, so every key gets its own slot. Pilots and slots sit right after an 8-byte
+// header: up to about 80 keys fit in 128 bytes, i.e. two cache lines.
+
+#define MHASH_TINY_MAX_KEYS 255
+#define MHASH_TINY_EMPTY ((uint8_t)0xFF)
+#define MHASH_TINY_DATA 512
+#ifndef MHASH_TINY_SEEDS
+#define MHASH_TINY_SEEDS 8
+#endif
+
+// Parameters of a tiny index, kept in front of its pilots and slots.
+typedef struct MHashTinyParams {
+    uint8_t count;
+    uint8_t num_buckets;
+    uint8_t prefix;      // leading key bytes that are hashed
+    uint8_t seed;
+    uint16_t table_size; // 1..256 slots
+    uint16_t reserved;
+} MHashTinyParams;
+
+typedef struct MHashTiny {
+    MHashTinyParams params;
+    uint8_t data[MHASH_TINY_DATA]; // pilots[num_buckets], then slots[table_size]
+} MHashTiny;
+
+static const uint8_t mhash__pearson[256] = {
+    172, 208, 128, 125, 227,   1, 114, 102,  27, 245,  24,  18, 199, 255,  43, 248,
+    184,  63,  68, 110,  55, 235,  53,  45, 203, 251,  49, 218, 246, 101,   7, 224,
+     82, 233,  38, 181, 185, 231, 106, 154, 253,  50, 202,  19, 159, 249, 176,  74,
+    243, 109, 148,  67, 209, 147, 130, 174,  12, 116, 164, 183,  58, 100,  15, 150,
+     76, 115,  92,  96, 117, 170, 232,  95,  28, 221, 219,  87,  85, 213,   0,  14,
+    200, 182, 160, 137,  66, 230,  70, 175, 119,  91, 140, 111,  26, 239, 254, 186,
+     47,  37, 163, 244, 226, 204,  39, 250,  51,  77, 133, 197, 139, 135,  84, 107,
+     81, 215, 201, 118, 113, 247,   3,  59,  78, 149, 141, 179, 162, 220, 169, 191,
+     71, 157, 190, 178,  52, 126, 194, 241, 105,   5, 134,  20, 152,  48, 103,  16,
+     44, 207,  97,  72, 161, 166, 240,  73, 206,  42, 121, 188,  80, 143,  29, 151,
+     11,   2, 155,  89, 167, 145,  62, 222, 156, 138, 158,  88,  99, 211, 136, 123,
+    120,  25, 205, 229,  40,  86, 242,   6, 146,  13, 228,  69, 187,  90, 122, 216,
+     75, 238, 192, 112,  36, 195, 177,  34, 252, 223, 129,  60,  33,  35,   9, 131,
+     61, 214, 217,   8, 180,   4, 189, 234, 196,  64, 142,  31,  93, 144,  32, 212,
+    104,  65, 225, 193,  22, 173,  46,  21,  57, 236, 124, 127,  83,  41,  56, 165,
+    132,  79,  98, 237,  30, 108, 168,  17,  23, 171,  10,  54, 153, 198, 210,  94,
+};
+
+// Three Pearson lanes over the first `prefix` bytes of s, packed as bucket | a << 8 | b << 16.
+// The lanes are independent, so their table reads overlap.
+static inline uint32_t mhash_tiny_hash(const void *_s, uint8_t prefix, uint8_t seed) {
+    const unsigned char *s = (const unsigned char *)_s;
+    uint8_t h0 = seed, h1 = (uint8_t)(seed ^ 0x55), h2 = (uint8_t)(seed ^ 0xAA);
+    for (uint8_t i = 0; i < prefix && s[i]; ++i) {
+        h0 = mhash__pearson[h0 ^ s[i]];
+        h1 = mhash__pearson[h1 ^ s[i]];
+        h2 = mhash__pearson[h2 ^ s[i]];
+    }
+    return (uint32_t)h0 | ((uint32_t)h1 << 8) | ((uint32_t)h2 << 16);
+}
+
+// Scales a byte to [0, n) with a multiply instead of a division; n <= 256 keeps every value reachable.
+static inline unsigned mhash__tiny_reduce(uint8_t x, unsigned n) {
+    return ((unsigned)x * n) >> 8;
+}
+
+static inline unsigned mhash__tiny_bucket(uint32_t h, unsigned num_buckets) {
+    return mhash__tiny_reduce((uint8_t)h, num_buckets);
+}
+
+// Every pilot maps a key to a different byte, so a bucket of one key can reach any free slot.
+static inline unsigned mhash__tiny_slot(uint32_t h, uint8_t pilot, unsigned table_size) {
+    return mhash__tiny_reduce(mhash__pearson[mhash__pearson[(uint8_t)(h >> 8) ^ pilot] ^ (uint8_t)(h >> 16)], table_size);
+}
+
+static inline int mhash__tiny_place(const MHashTinyParams *p, uint8_t *data, const uint32_t *hashes, size_t count) {
+    const unsigned num_buckets = p->num_buckets, table_size = p->table_size;
+    uint8_t *pilots = data, *table = data + num_buckets;
+    uint8_t bucket_size[MHASH_TINY_MAX_KEYS] = {0};
+    uint8_t order[MHASH_TINY_MAX_KEYS];
+    for (size_t i = 0; i < count; ++i)
+        bucket_size[mhash__tiny_bucket(hashes[i], num_buckets)]++;
+    // buckets by decreasing size (counting sort), so that the largest are placed while slots are free
+    size_t placed = 0;
+    for (int size = (int)count; size > 0; --size)
+        for (unsigned b = 0; b < num_buckets; ++b)
+            if (bucket_size[b] == size)
+                order[placed++] = (uint8_t)b;
+    memset(pilots, 0, num_buckets);
+    memset(table, MHASH_TINY_EMPTY, table_size);
+    for (size_t o = 0; o < placed; ++o) {
+        const uint8_t b = order[o];
+        uint8_t members[MHASH_TINY_MAX_KEYS];
+        unsigned m = 0;
+        for (size_t i = 0; i < count; ++i)
+            if (mhash__tiny_bucket(hashes[i], num_buckets) == b)
+                members[m++] = (uint8_t)i;
+        int found = 0;
+        for (unsigned pilot = 0; pilot < 256 && !found; ++pilot) {
+            unsigned j = 0;
+            for (; j < m; ++j) {
+                const unsigned slot = mhash__tiny_slot(hashes[members[j]], (uint8_t)pilot, table_size);
+                if (table[slot] != MHASH_TINY_EMPTY)
+                    break;
+                table[slot] = members[j];
+            }
+            if (j == m) {
+                pilots[b] = (uint8_t)pilot;
+                found = 1;
+            } else {
+                while (j--)
+                    table[mhash__tiny_slot(hashes[members[j]], (uint8_t)pilot, table_size)] = MHASH_TINY_EMPTY;
+            }
+        }
+        if (!found)
+            return MHASH_FAILED;
+    }
+    return MHASH_OK;
+}
+
+// Builds the smallest layout it finds for count <= MHASH_TINY_MAX_KEYS NUL-terminated keys
+// whose pilots and slots fit in `capacity` bytes at data. Fails on duplicate keys, on keys
+// that share their first 255 bytes, or when no layout fits.
+static inline int mhash_tiny_build(MHashTinyParams *p,
+                        uint8_t *data,
+                        size_t capacity,
+                        const void **strings,
+                        size_t count) {
+    if (!p || !data || (!strings && count) || count > MHASH_TINY_MAX_KEYS || capacity < 2)
+        return MHASH_FAILED;
+    memset(p, 0, sizeof(*p));
+    // hash the shortest prefix that differs between all keys
+    size_t prefix = 1;
+    for (size_t i = 0; i < count; ++i)
+        for (size_t j = i + 1; j < count; ++j) {
+            const unsigned char *a = (const unsigned char *)strings[i], *b = (const unsigned char *)strings[j];
+            size_t common = 0;
+            while (a[common] && a[common] == b[common])
+                ++common;
+            if (a[common] == b[common] || common >= 255)
+                return MHASH_FAILED;
+            if (common + 1 > prefix)
+                prefix = common + 1;
+        }
+    p->prefix = (uint8_t)prefix;
+    p->num_buckets = 1;
+    p->table_size = 1;
+    if (count == 0) {
+        data[1] = MHASH_TINY_EMPTY;
+        return MHASH_OK;
+    }
+    uint32_t hashes[MHASH_TINY_MAX_KEYS];
+    for (unsigned table_size = (unsigned)count; table_size <= 256; ++table_size) {
+        const size_t bucket_options[3] = {(count + 3) / 4, (count + 1) / 2, count};
+        for (int option = 0; option < 3; ++option) {
+            const size_t num_buckets = bucket_options[option];
+            if ((option && num_buckets == bucket_options[option - 1]) || num_buckets + table_size > capacity)
+                continue;
+            p->num_buckets = (uint8_t)num_buckets;
+            p->table_size = (uint16_t)table_size;
+            for (unsigned seed = 0; seed < MHASH_TINY_SEEDS; ++seed) {
+                p->seed = (uint8_t)seed;
+                for (size_t i = 0; i < count; ++i)
+                    hashes[i] = mhash_tiny_hash(strings[i], p->prefix, p->seed);
+                if (mhash__tiny_place(p, data, hashes, count) == MHASH_OK) {
+                    p->count = (uint8_t)count;
+                    return MHASH_OK;
+                }
+            }
+        }
+    }
+    return MHASH_FAILED;
+}
+
+// Entry id of a registered key; for other keys it returns MHASH_TINY_EMPTY or an unrelated id.
+static inline uint8_t mhash_tiny_lookup(const MHashTinyParams *p, const uint8_t *data, const void *s) {
+    const uint32_t h = mhash_tiny_hash(s, p->prefix, p->seed);
+    const uint8_t pilot = data[mhash__tiny_bucket(h, p->num_buckets)];
+    return data[p->num_buckets + mhash__tiny_slot(h, pilot, p->table_size)];
+}
+
+static inline int mhash_tiny_init(MHashTiny *t, const void **strings, size_t count) {
+    if (!t)
+        return MHASH_FAILED;
+    return mhash_tiny_build(&t->params, t->data, MHASH_TINY_DATA, strings, count);
+}
+
+// Bytes of the map that lookups touch.
+static inline size_t mhash_tiny_bytes(const MHashTiny *t) {
+    return offsetof(MHashTiny, data) + t->params.num_buckets + t->params.table_size;
+}
+
+static inline uint8_t mhash_tiny_entry(const MHashTiny *t, const void *s) {
+    return mhash_tiny_lookup(&t->params, t->data, s);
+}
+
+static inline void *mhash_tiny_check_at(const MHashTiny *t,
+                          const void *s,
+                          const void **keys,
+                          void *values,
+                          size_t sizeof_value,
+                          int (*cmp_func)(const void *, const void *)) {
+    const uint8_t entry = mhash_tiny_entry(t, s);
+    if (entry == MHASH_TINY_EMPTY || cmp_func(keys[entry], s))
+        return NULL;
+    return (char *)values + ((size_t)entry * sizeof_value);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MHASH_TINY_H
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2025 Emmanouil Krasanakis
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MHASH_TYPED_H
+#define MHASH_TYPED_H
+
+#include "mhash.h"
+
+// Type-specialized maps. MHASH_DEFINE_MAP(name, KeyT, ValT, hashfn, cmpfn) defines
+//   typedef struct name { ... } name;
+//   int   name_init(name *m, MHASH_INDEX_UINT *table, size_t table_size,
+//                   const KeyT *keys, ValT *values, size_t count);
+//   ValT *name_get(const name *m, KeyT key);
+//   void  name_get_batch(const name *m, const KeyT *queries, size_t count, ValT **results);
+// with the semantics of mhash_init, mhash_check_at and mhash_check_at_batch. The map keeps
+// pointers to keys and values, which must outlive it. hashfn(key, id) and cmpfn(a, b) are
+// called directly with KeyT arguments and values are indexed as ValT, so lookups inline
+// without function pointers or a runtime value stride. For string keys, mhash_str_prefix
+// and mhash_strcmp can be used as they are:
+//   MHASH_DEFINE_MAP(str_int_map, const char *, int, mhash_str_prefix, mhash_strcmp)
+#define MHASH_DEFINE_MAP(name, KeyT, ValT, hashfn, cmpfn)                                          \
+typedef KeyT name##_key;                                                                          \
+typedef ValT name##_value;                                                                        \
+                                                                                                  \
+typedef struct name {                                                                             \
+    MHASH_INDEX_UINT *table;                                                                      \
+    size_t table_size;                                                                            \
+    MHASH_UINT num_hashes;                                                                        \
+    size_t count;                                                                                 \
+    const name##_key *keys;                                                                       \
+    name##_value *values;                                                                         \
+} name;                                                                                           \
+                                                                                                  \
+static inline MHASH_UINT name##__concat(name##_key key, MHASH_UINT num_hashes) {                 \
+    MHASH_UINT combined = 0;                                                                      \
+    for (MHASH_UINT i = 1; i <= num_hashes; ++i)                                                  \
+        combined ^= hashfn(key, i);                                                               \
+    return combined;                                                                              \
+}                                                                                                 \
+                                                                                                  \
+static inline MHASH_UINT name##__pos(const name *m, name##_key key) {                             \
+    return name##__concat(key, m->num_hashes) % (MHASH_UINT)m->table_size;                        \
+}                                                                                                 \
+                                                                                                  \
+/* lets mhash__search place the typed keys held in context */                                     \
+static inline size_t name##__slot(const MHashKeySource *source, size_t i,                         \
+                                  MHASH_UINT num_hashes, size_t table_size) {                     \
+    const name##_key *keys = (const name##_key *)source->context;                                 \
+    return (size_t)(name##__concat(keys[i], num_hashes) % (MHASH_UINT)table_size);                \
+}                                                                                                 \
+                                                                                                  \
+static inline int name##_init(name *m,                                                            \
+                        MHASH_INDEX_UINT *table,                                                  \
+                        size_t table_size,                                                        \
+                        const name##_key *keys,                                                   \
+                        name##_value *values,                                                     \
+                        size_t count) {                                                           \
+    if (!m || !table || (!keys && count) || table_size == 0)                                      \
+        return MHASH_FAILED;                                                                      \
+    m->table      = table;                                                                        \
+    m->table_size = table_size;                                                                   \
+    m->count      = count;                                                                        \
+    m->keys       = keys;                                                                         \
+    m->values     = values;                                                                       \
+    MHash ph;                                                                                     \
+    mhash__setup(&ph, table, table_size, count, NULL, 0);                                         \
+    const MHashKeySource source = {NULL, NULL, NULL, name##__slot, keys};                         \
+    const int status = mhash__search(&ph, &source);                                               \
+    m->num_hashes = ph.num_hashes;                                                                \
+    return status;                                                                                \
+}                                                                                                 \
+                                                                                                  \
+static inline name##_value *name##_get(const name *m, name##_key key) {                           \
+    MHASH_INDEX_UINT entry = m->table[name##__pos(m, key)];                                       \
+    if (entry == MHASH_EMPTY_SLOT || cmpfn(m->keys[entry], key))                                  \
+        return NULL;                                                                              \
+    return m->values + entry;                                                                     \
+}                                                                                                 \
+                                                                                                  \
+static inline void name##_get_batch(const name *m,                                                \
+                        const name##_key *queries,                                                \
+                        size_t num_queries,                                                       \
+                        name##_value **results) {                                                 \
+    MHASH_UINT idx[MHASH_BATCH];                                                                  \
+    MHASH_INDEX_UINT entry[MHASH_BATCH];                                                          \
+    for (size_t base = 0; base < num_queries; base += MHASH_BATCH) {                              \
+        size_t n = num_queries - base;                                                            \
+        if (n > MHASH_BATCH) n = MHASH_BATCH;                                                     \
+        for (size_t i = 0; i < n; ++i) {                                                          \
+            idx[i] = name##__pos(m, queries[base + i]);                                           \
+            MHASH_PREFETCH(&m->table[idx[i]]);                                                    \
+        }                                                                                         \
+        for (size_t i = 0; i < n; ++i) {                                                          \
+            entry[i] = m->table[idx[i]];                                                          \
+            if (entry[i] != MHASH_EMPTY_SLOT)                                                     \
+                MHASH__PREFETCH_KEY(m->keys, entry[i]);                                           \
+        }                                                                                         \
+        for (size_t i = 0; i < n; ++i) {                                                          \
+            if (entry[i] == MHASH_EMPTY_SLOT || cmpfn(m->keys[entry[i]], queries[base + i]))      \
+                results[base + i] = NULL;                                                         \
+            else                                                                                  \
+                results[base + i] = m->values + entry[i];                                         \
+        }                                                                                         \
+    }                                                                                             \
+}
+
+// Prefetches what cmpfn reads of keys[i]: the key it points to for pointer keys, as
+// mhash_check_at_batch does, or the stored key itself otherwise.
+#if defined(__GNUC__) || defined(__clang__)
+#define MHASH__PREFETCH_KEY(keys, i)                                                             \
+    MHASH_PREFETCH(__builtin_classify_type(*(keys)) == 5 /* pointer */                            \
+                   ? *(const void *const *)&(keys)[i] : (const void *)&(keys)[i])
+#else
+#define MHASH__PREFETCH_KEY(keys, i) MHASH_PREFETCH(&(keys)[i])
+#endif
+
+#endif // MHASH_TYPED_H
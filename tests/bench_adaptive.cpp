@@ -0,0 +1,77 @@
+// g++ tests/bench_adaptive.cpp -o tests/bench_adaptive -O3 -std=c++20
+// usage: tests/bench_adaptive [key_length]   (defaults to 16)
+// Times the prefix scan and the hash table of MHashMap per map size and reports the
+// crossover that MHASH_SCAN_MAX should be set to on this machine.
+
+#include "../mhash_cpp.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace std;
+using Clock = chrono::high_resolution_clock;
+
+static vector<string> make_random_strings(size_t n, size_t len) {
+    static const char charset[] =
+        "abcdefghijklmnopqrstuvwxyz"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "0123456789";
+    mt19937_64 rng{12345};
+    uniform_int_distribution<size_t> dist(0, sizeof(charset) - 2);
+    vector<string> out;
+    out.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        string s;
+        for (size_t j = 0; j < len; ++j)
+            s.push_back(charset[dist(rng)]);
+        out.push_back(std::move(s));
+    }
+    return out;
+}
+
+static double time_lookups(size_t scan_max, const vector<string>& keys, const vector<size_t>& queries, size_t& checksum) {
+    MHashMap<int> map(scan_max);
+    for (size_t i = 0; i < keys.size(); ++i)
+        map.insert(keys[i], int(i));
+    map.build();
+    double best = 1e9;
+    for (int repeat = 0; repeat < 5; ++repeat) {
+        auto start = Clock::now();
+        for (size_t q : queries)
+            checksum += *map.get(keys[q]);
+        chrono::duration<double> t = Clock::now() - start;
+        best = min(best, t.count() / queries.size() * 1e9);
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    const size_t len = argc > 1 ? strtoull(argv[1], nullptr, 10) : 16;
+    constexpr size_t MAX_KEYS = 32;
+    constexpr size_t N_LOOKUPS = 1000000;
+    size_t checksum = 0, crossover = 0;
+    bool crossed = false;
+
+    cout << "| keys | scan | mhash | faster |\n";
+    cout << "|------|------|-------|--------|\n";
+    for (size_t n = 1; n <= MAX_KEYS; ++n) {
+        auto keys = make_random_strings(n, len);
+        mt19937_64 rng(42);
+        uniform_int_distribution<size_t> dist(0, n - 1);
+        vector<size_t> queries(N_LOOKUPS);
+        for (auto& q : queries) q = dist(rng);
+        const double scan = time_lookups(SIZE_MAX, keys, queries, checksum);
+        const double hash = time_lookups(0, keys, queries, checksum);
+        printf("| %zu | %.1fns | %.1fns | %s |\n", n, scan, hash, scan <= hash ? "scan" : "mhash");
+        if (scan > hash) crossed = true;
+        if (!crossed) crossover = n;
+    }
+    // past the crossover the scan still wins at sizes that need many hashes, but loses on average
+    printf("\ncrossover: the scan wins up to %zu keys (MHASH_SCAN_MAX is %d)\n", crossover, MHASH_SCAN_MAX);
+    if (checksum == 0) cout << "checksum=0\n";
+    return 0;
+}
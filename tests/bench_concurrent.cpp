@@ -0,0 +1,120 @@
+// g++ tests/bench_concurrent.cpp -o tests/bench_concurrent -O3 -std=c++20 -pthread
+
+#include "../mhash_concurrent.h"
+#include <iostream>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+
+using namespace std;
+using Clock = chrono::high_resolution_clock;
+
+static vector<string> make_random_strings(size_t n, size_t len) {
+    static const char charset[] =
+        "abcdefghijklmnopqrstuvwxyz"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "0123456789";
+    static thread_local mt19937_64 rng{12345};
+    uniform_int_distribution<size_t> dist(0, sizeof(charset) - 2);
+
+    vector<string> out;
+    out.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        string s;
+        s.reserve(len);
+        for (size_t j = 0; j < len; ++j)
+            s.push_back(charset[dist(rng)]);
+        out.push_back(std::move(s));
+    }
+    return out;
+}
+
+// sum of the values found by the lookup threads, so the lookups cannot be optimized out
+static atomic<size_t> checksum{0};
+
+// runs `readers` lookup threads against one rebuilding writer and returns lookups/s
+template<typename Lookup, typename Rebuild>
+static double run(unsigned readers, Lookup lookup, Rebuild rebuild, size_t& rebuilds) {
+    atomic<bool> stop{false};
+    atomic<size_t> total{0};
+    vector<thread> threads;
+    for (unsigned t = 0; t < readers; ++t)
+        threads.emplace_back([&, t]() {
+            size_t count = lookup(stop, t);
+            total += count;
+        });
+    auto start = Clock::now();
+    rebuilds = 0;
+    while (Clock::now() - start < chrono::seconds(1)) {
+        rebuild();
+        ++rebuilds;
+    }
+    stop = true;
+    for (auto& t : threads)
+        t.join();
+    chrono::duration<double> elapsed = Clock::now() - start;
+    return total / elapsed.count();
+}
+
+int main() {
+    constexpr size_t N = 200;
+    const unsigned readers = max(2u, thread::hardware_concurrency());
+    auto keys = make_random_strings(N, 16);
+    vector<int> values(N);
+    for (size_t i = 0; i < N; ++i)
+        values[i] = int(i);
+
+    size_t rebuilds;
+    {
+        MHashPublisher<MHashFrozenMap<int>> published(make_unique<const MHashFrozenMap<int>>(keys, values));
+        double rate = run(readers, [&](atomic<bool>& stop, unsigned t) {
+            MHashPublisher<MHashFrozenMap<int>>::Reader reader(published);
+            mt19937_64 rng(t);
+            size_t count = 0, found = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                auto snapshot = reader.acquire();
+                for (int i = 0; i < 64; ++i)
+                    found += *snapshot->get(keys[rng() % N]);
+                count += 64;
+            }
+            checksum += found;
+            return count;
+        }, [&]() {
+            published.publish(make_unique<const MHashFrozenMap<int>>(keys, values));
+        }, rebuilds);
+        cout << "MHashPublisher:      " << rate / 1e6 << " M lookups/s with " << rebuilds << " rebuilds/s, checksum=" << checksum.exchange(0) << "\n";
+    }
+
+    {
+        shared_mutex lock;
+        auto map = make_unique<MHashMap<int>>();
+        for (size_t i = 0; i < N; ++i)
+            map->insert(keys[i], values[i]);
+        map->build();
+        double rate = run(readers, [&](atomic<bool>& stop, unsigned t) {
+            mt19937_64 rng(t);
+            size_t count = 0, found = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                for (int i = 0; i < 64; ++i) {
+                    shared_lock<shared_mutex> guard(lock);
+                    found += *map->get(keys[rng() % N]);
+                }
+                count += 64;
+            }
+            checksum += found;
+            return count;
+        }, [&]() {
+            auto next = make_unique<MHashMap<int>>();
+            for (size_t i = 0; i < N; ++i)
+                next->insert(keys[i], values[i]);
+            next->build();
+            unique_lock<shared_mutex> guard(lock);
+            map.swap(next);
+        }, rebuilds);
+        cout << "shared_mutex:        " << rate / 1e6 << " M lookups/s with " << rebuilds << " rebuilds/s, checksum=" << checksum.exchange(0) << "\n";
+    }
+    return 0;
+}
@@ -1,4 +1,4 @@
-// g++ tests/bench_cpp.cpp -o tests/bench_cpp -O3 -std=c++20
+// g++ tests/bench_cpp.cpp -o tests/bench_cpp -O3 -std=c++20 -pthread
 
 #include "../mhash_cpp.h"
 #include <iostream>
@@ -7,6 +7,7 @@
 #include <random>
 #include <chrono>
 #include <string>
+#include <thread>
 
 using namespace std;
 using Clock = chrono::high_resolution_clock;
@@ -80,5 +81,29 @@ int main() {
         cout << "unordered_map get time: " << elapsed.count() << " s, checksum=" << found << "\n";
     }
 
+    {
+        cout << "\nBenchmarking MHashMap::parallel_get_many...\n";
+        MHashMap<int> mhash;
+        for (size_t i = 0; i < N; ++i)
+            mhash.insert(keys[i], int(i));
+        mhash.build();
+        vector<string> queries(N * REPEATS / 10);
+        for (auto& q : queries)
+            q = keys[dist(rng)];
+        vector<const int*> out(queries.size());
+
+        const unsigned max_threads = max(1u, thread::hardware_concurrency());
+        for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+            auto start = Clock::now();
+            mhash.parallel_get_many(queries.data(), queries.size(), out.data(), threads);
+            auto end = Clock::now();
+            size_t found = 0;
+            for (auto* v : out)
+                found += *v;
+            chrono::duration<double> elapsed = end - start;
+            cout << threads << " threads: " << queries.size() / elapsed.count() / 1e6 << " M lookups/s, checksum=" << found << "\n";
+        }
+    }
+
     return 0;
 }
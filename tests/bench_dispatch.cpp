@@ -0,0 +1,159 @@
+// g++ tests/bench_dispatch.cpp -o tests/bench_dispatch -O3 -std=c++20
+// Command dispatch on a Redis-like command set: mhash_dispatch and MHashDispatcher against
+// a switch on the first character and an if/strcmp chain, with 5% unknown commands.
+// The last rows match case-insensitively, against a strcasecmp chain.
+
+#include "../mhash_cpp.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <strings.h>
+
+using namespace std;
+using Clock = chrono::high_resolution_clock;
+
+#define N_LOOKUPS 1000000
+#define N_REPS    20
+
+static const char* commands[] = {
+    "GET", "SET", "DEL", "EXISTS", "EXPIRE", "TTL", "INCR", "DECR", "APPEND", "MGET",
+    "MSET", "HGET", "HSET", "HDEL", "LPUSH", "RPUSH", "LPOP", "RPOP", "LRANGE", "SADD",
+    "SREM", "SMEMBERS", "ZADD", "ZRANGE", "ZREM", "PING", "ECHO", "INFO", "KEYS", "SCAN"};
+static constexpr int num_commands = sizeof(commands) / sizeof(commands[0]);
+
+template<int I>
+[[gnu::noinline]] static int handler(void* ctx, void*) {
+    return ++static_cast<int*>(ctx)[I];
+}
+template<int I>
+[[gnu::noinline]] static int cpp_handler(int* counts) {
+    return ++counts[I];
+}
+
+template<int... I>
+static vector<mhash_handler> c_handlers(integer_sequence<int, I...>) { return {&handler<I>...}; }
+template<int... I>
+static vector<int (*)(int*)> cpp_handlers(integer_sequence<int, I...>) { return {&cpp_handler<I>...}; }
+
+#define CMD(I, NAME) if (len == sizeof(NAME) - 1 && !memcmp(s, NAME, len)) return handler<I>(counts, nullptr)
+
+static int dispatch_switch(const char* s, size_t len, int* counts) {
+    switch (s[0]) {
+    case 'A': CMD(8, "APPEND"); break;
+    case 'D': CMD(2, "DEL"); CMD(7, "DECR"); break;
+    case 'E': CMD(3, "EXISTS"); CMD(4, "EXPIRE"); CMD(26, "ECHO"); break;
+    case 'G': CMD(0, "GET"); break;
+    case 'H': CMD(11, "HGET"); CMD(12, "HSET"); CMD(13, "HDEL"); break;
+    case 'I': CMD(6, "INCR"); CMD(27, "INFO"); break;
+    case 'K': CMD(28, "KEYS"); break;
+    case 'L': CMD(14, "LPUSH"); CMD(16, "LPOP"); CMD(18, "LRANGE"); break;
+    case 'M': CMD(9, "MGET"); CMD(10, "MSET"); break;
+    case 'P': CMD(25, "PING"); break;
+    case 'R': CMD(15, "RPUSH"); CMD(17, "RPOP"); break;
+    case 'S': CMD(1, "SET"); CMD(19, "SADD"); CMD(20, "SREM"); CMD(21, "SMEMBERS"); CMD(29, "SCAN"); break;
+    case 'T': CMD(5, "TTL"); break;
+    case 'Z': CMD(22, "ZADD"); CMD(23, "ZRANGE"); CMD(24, "ZREM"); break;
+    }
+    return -1;
+}
+
+template<int (*Cmp)(const char*, const char*), int... I>
+static int dispatch_chain(const char* s, int* counts, integer_sequence<int, I...>) {
+    int result = -1;
+    // stops at the first match, like a hand-written if/else chain in command order
+    (void)((Cmp(s, commands[I]) == 0 ? (result = handler<I>(counts, nullptr), true) : false) || ...);
+    return result;
+}
+
+struct Query {
+    string name;
+    size_t length;
+};
+
+static vector<Query> make_queries(mt19937& rng, bool mixed_case) {
+    vector<Query> queries(N_LOOKUPS);
+    uniform_int_distribution<int> pick(0, num_commands - 1), percent(0, 99), coin(0, 1);
+    for (auto& q : queries) {
+        q.name = percent(rng) < 5 ? "UNKNOWN" + to_string(pick(rng)) : commands[pick(rng)];
+        if (mixed_case)
+            for (auto& c : q.name)
+                if (coin(rng)) c = (char)tolower((unsigned char)c);
+        q.length = q.name.size();
+    }
+    return queries;
+}
+
+template<typename F>
+static double best_ns(const vector<Query>& queries, F&& dispatch) {
+    double best = 1e30;
+    for (int rep = 0; rep < N_REPS; ++rep) {
+        auto start = Clock::now();
+        long long sum = 0;
+        for (const auto& q : queries)
+            sum += dispatch(q);
+        auto end = Clock::now();
+        volatile long long sink = sum;
+        (void)sink;
+        best = min(best, chrono::duration<double, nano>(end - start).count() / queries.size());
+    }
+    return best;
+}
+
+int main() {
+    mt19937 rng(42);
+    const auto seq = make_integer_sequence<int, num_commands>{};
+    const vector<mhash_handler> handlers = c_handlers(seq);
+    const vector<int (*)(int*)> typed = cpp_handlers(seq);
+    vector<int> counts(num_commands);
+    int* c = counts.data();
+
+    MHashDispatch exact, nocase;
+    if (mhash_dispatch_init(&exact, commands, handlers.data(), num_commands, 0)
+        || mhash_dispatch_init(&nocase, commands, handlers.data(), num_commands, MHASH_DISPATCH_NOCASE)) {
+        cerr << "Failed to build dispatch tables" << endl;
+        return 1;
+    }
+    MHashDispatcher<int(int*)> dispatcher;
+    for (int i = 0; i < num_commands; ++i)
+        dispatcher.add(commands[i], typed[i]);
+    dispatcher.on_unknown([](int*) { return -1; });
+    dispatcher.build();
+
+    cout << num_commands << " commands, " << exact.table_size << " slots, " << exact.num_hashes << " hashes" << endl;
+    cout << "| dispatch | ns/call |" << endl;
+    cout << "|----------|---------|" << endl;
+    auto row = [](const char* name, double ns) { cout << "| " << name << " | " << ns << " |" << endl; };
+
+    const vector<Query> queries = make_queries(rng, false);
+    row("mhash_dispatch", best_ns(queries, [&](const Query& q) {
+        int result = -1;
+        mhash_dispatch(&exact, q.name.data(), q.length, c, nullptr, &result);
+        return result;
+    }));
+    row("MHashDispatcher", best_ns(queries, [&](const Query& q) {
+        return dispatcher(string_view(q.name.data(), q.length), c);
+    }));
+    row("switch on first char", best_ns(queries, [&](const Query& q) {
+        return dispatch_switch(q.name.c_str(), q.length, c);
+    }));
+    row("strcmp chain", best_ns(queries, [&](const Query& q) {
+        return dispatch_chain<strcmp>(q.name.c_str(), c, seq);
+    }));
+
+    const vector<Query> mixed = make_queries(rng, true);
+    row("mhash_dispatch nocase, mixed case", best_ns(mixed, [&](const Query& q) {
+        int result = -1;
+        mhash_dispatch(&nocase, q.name.data(), q.length, c, nullptr, &result);
+        return result;
+    }));
+    row("strcasecmp chain, mixed case", best_ns(mixed, [&](const Query& q) {
+        return dispatch_chain<strcasecmp>(q.name.c_str(), c, seq);
+    }));
+
+    mhash_dispatch_free(&exact);
+    mhash_dispatch_free(&nocase);
+    return 0;
+}
@@ -0,0 +1,106 @@
+// COMPILE WITH: gcc tests/mhash_gen.c -o tests/mhash_gen -O2 && tests/mhash_gen tests/keywords.txt keywords tests/keywords_map && gcc tests/bench_gen.c tests/keywords_map.c -o tests/bench_gen -O3 -lm
+
+#include "../mhash.h"
+#include "../mhash_str.h"
+#include "keywords_map.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define N_LOOKUPS 1000000
+#define N_REPS    20
+#define N_MISSES  64
+
+static inline double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp((const char *)a, (const char *)b);
+}
+
+// Generated lookup against mhash_check_at on the same keys and table size, for queries
+// that hit and for identifier-like queries that miss (as a SQL tokenizer sees both).
+int main(void) {
+    srand(42);
+    const size_t n = KEYWORDS_COUNT;
+    const void **keys = (const void **)keywords_keys;
+    int *values = malloc(n * sizeof(int));
+    for (size_t i = 0; i < n; ++i)
+        values[i] = (int)i;
+
+    // runtime map found by the same search as the generator's
+    size_t max_hashes = 0;
+    for (size_t m = n; m; m >>= 1)
+        ++max_hashes;
+    max_hashes += 2;
+    size_t table_size = n * 3;
+    MHash map;
+    MHASH_INDEX_UINT *table = NULL;
+    for (;;) {
+        table = realloc(table, table_size * sizeof(MHASH_INDEX_UINT));
+        const int status = mhash_init(&map, table, table_size, keys, n, mhash_str_prefix);
+        if (status == MHASH_OK && map.num_hashes < max_hashes)
+            break;
+        const size_t next = table_size < 16 ? table_size + 1 : table_size + table_size / 5 + 1;
+        if (next > 65536 || next > 128 * n) {
+            if (status != MHASH_OK) {
+                fprintf(stderr, "Failed to build map\n");
+                return 1;
+            }
+            break;
+        }
+        table_size = next;
+    }
+
+    char misses[N_MISSES][16];
+    for (size_t i = 0; i < N_MISSES; ++i)
+        snprintf(misses[i], sizeof(misses[i]), "col_%zu", (size_t)rand() % 100000);
+
+    const char **queries = malloc(N_LOOKUPS * sizeof(char *));
+    size_t *lengths = malloc(N_LOOKUPS * sizeof(size_t));
+
+    printf("%zu keys, %zu slots, %llu hashes\n", n, map.table_size, (unsigned long long)map.num_hashes);
+    printf("| queries | mhash_check_at | generated |\n");
+    printf("|---------|----------------|-----------|\n");
+    for (int hit_rate = 100; hit_rate >= 0; hit_rate -= 50) {
+        for (size_t i = 0; i < N_LOOKUPS; ++i) {
+            queries[i] = rand() % 100 < hit_rate ? keywords_keys[rand() % n] : misses[rand() % N_MISSES];
+            lengths[i] = strlen(queries[i]);
+        }
+        double best_mhash = 1e30, best_gen = 1e30;
+        volatile long long sink = 0;
+        for (int rep = 0; rep < N_REPS; ++rep) {
+            double t0 = now_sec();
+            long long sum = 0;
+            for (size_t i = 0; i < N_LOOKUPS; ++i) {
+                int *v = (int *)mhash_check_at(&map, queries[i], keys, values, sizeof(int), cmp_str);
+                sum += v ? *v : -1;
+            }
+            double t1 = now_sec();
+            for (size_t i = 0; i < N_LOOKUPS; ++i) {
+                int id = keywords_lookup(queries[i], lengths[i]);
+                sum -= id >= 0 ? values[id] : -1;
+            }
+            double t2 = now_sec();
+            if (sum != 0) {
+                fprintf(stderr, "lookups disagree\n");
+                return 1;
+            }
+            sink += sum;
+            if (t1 - t0 < best_mhash) best_mhash = t1 - t0;
+            if (t2 - t1 < best_gen) best_gen = t2 - t1;
+        }
+        printf("| %3d%% hits | %11.2f ns | %6.2f ns |\n", hit_rate,
+               best_mhash * 1e9 / N_LOOKUPS, best_gen * 1e9 / N_LOOKUPS);
+    }
+
+    free(queries);
+    free(lengths);
+    free(table);
+    free(values);
+    return 0;
+}
@@ -0,0 +1,102 @@
+// g++ tests/bench_hybrid.cpp -o tests/bench_hybrid -O3 -std=c++20 -pthread
+
+#include "../mhash_concurrent.h"
+#include <iostream>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+
+using namespace std;
+using Clock = chrono::high_resolution_clock;
+
+static vector<string> make_random_strings(size_t n, size_t len, uint64_t seed) {
+    static const char charset[] =
+        "abcdefghijklmnopqrstuvwxyz"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "0123456789";
+    mt19937_64 rng{seed};
+    uniform_int_distribution<size_t> dist(0, sizeof(charset) - 2);
+
+    vector<string> out;
+    out.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        string s;
+        s.reserve(len);
+        for (size_t j = 0; j < len; ++j)
+            s.push_back(charset[dist(rng)]);
+        out.push_back(std::move(s));
+    }
+    return out;
+}
+
+template<typename Work>
+static double run(unsigned threads, Work work) {
+    vector<thread> pool;
+    auto start = Clock::now();
+    for (unsigned t = 0; t < threads; ++t)
+        pool.emplace_back(work, t);
+    for (auto& t : pool)
+        t.join();
+    chrono::duration<double> elapsed = Clock::now() - start;
+    return elapsed.count();
+}
+
+int main() {
+    constexpr size_t CORE = 100000;
+    constexpr size_t INSERTS = 20000;
+    constexpr size_t LOOKUPS_PER_INSERT = 16;
+    const unsigned threads = max(2u, thread::hardware_concurrency());
+    auto core_keys = make_random_strings(CORE, 16, 1);
+    vector<int> core_values(CORE);
+    for (size_t i = 0; i < CORE; ++i)
+        core_values[i] = int(i);
+    vector<vector<string>> new_keys(threads);
+    for (unsigned t = 0; t < threads; ++t)
+        new_keys[t] = make_random_strings(INSERTS, 16, 100 + t);
+    const double ops = double(threads) * INSERTS * (LOOKUPS_PER_INSERT + 1);
+
+    // each thread inserts its own new keys, with LOOKUPS_PER_INSERT lookups of core keys in between
+    {
+        MHashHybridMap<int> map(core_keys, core_values, 16384);
+        double elapsed = run(threads, [&](unsigned t) {
+            MHashHybridMap<int>::Reader reader(map);
+            mt19937_64 rng(t);
+            size_t found = 0;
+            for (size_t i = 0; i < INSERTS; ++i) {
+                reader.insert(new_keys[t][i], int(i));
+                for (size_t j = 0; j < LOOKUPS_PER_INSERT; ++j)
+                    found += *reader.get(core_keys[rng() % CORE]);
+            }
+            if (found == 0) cout << "checksum=0\n";
+        });
+        cout << "MHashHybridMap:            " << ops / elapsed / 1e6 << " M ops/s (" << threads << " threads)\n";
+    }
+
+    {
+        mutex lock;
+        unordered_map<string, int> map;
+        for (size_t i = 0; i < CORE; ++i)
+            map.emplace(core_keys[i], core_values[i]);
+        double elapsed = run(threads, [&](unsigned t) {
+            mt19937_64 rng(t);
+            size_t found = 0;
+            for (size_t i = 0; i < INSERTS; ++i) {
+                {
+                    lock_guard<mutex> guard(lock);
+                    map.emplace(new_keys[t][i], int(i));
+                }
+                for (size_t j = 0; j < LOOKUPS_PER_INSERT; ++j) {
+                    lock_guard<mutex> guard(lock);
+                    found += map.find(core_keys[rng() % CORE])->second;
+                }
+            }
+            if (found == 0) cout << "checksum=0\n";
+        });
+        cout << "mutex + unordered_map:     " << ops / elapsed / 1e6 << " M ops/s (" << threads << " threads)\n";
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+// g++ tests/bench_keys.cpp -o tests/bench_keys -O3 -std=c++20 -pthread
+// usage: tests/bench_keys [num_keys]   (defaults to 2M)
+
+#include "../mhash_shard.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+
+using namespace std;
+using Clock = chrono::high_resolution_clock;
+
+// URL-like keys: few hosts and sections, so neighbouring sorted keys share long prefixes
+static vector<string> make_urls(size_t n) {
+    static const char* hosts[] = {"https://www.example.com", "https://cdn.example.net", "https://docs.example.org"};
+    static const char* sections[] = {"/catalog/electronics/", "/catalog/garden/", "/blog/2024/", "/api/v2/users/"};
+    mt19937_64 rng{12345};
+    vector<string> out;
+    out.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        string s = hosts[rng() % 3];
+        s += sections[rng() % 4];
+        s += "item-" + to_string(i) + "/details.html";
+        out.push_back(std::move(s));
+    }
+    return out;
+}
+
+template<typename Map>
+static double time_lookups(const Map& map, const vector<string>& keys, size_t lookups, size_t& checksum) {
+    mt19937_64 rng(42);
+    uniform_int_distribution<size_t> dist(0, keys.size() - 1);
+    auto start = Clock::now();
+    for (size_t i = 0; i < lookups; ++i)
+        checksum += *map.get(keys[dist(rng)]);
+    chrono::duration<double> t = Clock::now() - start;
+    return t.count() / lookups * 1e9;
+}
+
+int main(int argc, char** argv) {
+    const size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 2000000;
+    constexpr size_t N_LOOKUPS = 5000000;
+    auto keys = make_urls(n);
+    size_t raw = 0;
+    for (auto& k : keys) raw += k.size() + 1;
+
+    MHashShardedMap<uint32_t> map;
+    for (size_t i = 0; i < n; ++i)
+        map.insert(keys[i], uint32_t(i));
+    map.build(max(1u, thread::hardware_concurrency()));
+
+    size_t checksum = 0;
+    cout << "| keys | avg key | storage | key bytes/key | lookup |\n";
+    cout << "|------|---------|---------|---------------|--------|\n";
+    double ns = time_lookups(map, keys, N_LOOKUPS, checksum);
+    printf("| %zu | %.1fB | pool | %.1f | %.0fns |\n", n, double(raw) / n, double(map.key_bytes()) / n, ns);
+    for (size_t block : {8, 16, 32}) {
+        map.compress_keys(block);
+        ns = time_lookups(map, keys, N_LOOKUPS, checksum);
+        printf("| %zu | %.1fB | front-coded/%zu | %.1f | %.0fns |\n", n, double(raw) / n, block, double(map.key_bytes()) / n, ns);
+    }
+    if (map.get("https://www.example.com/missing")) cout << "false positive\n";
+    if (checksum == 0) cout << "checksum=0\n";
+    return 0;
+}
@@ -0,0 +1,105 @@
+// g++ tests/bench_layout.cpp -o tests/bench_layout -O3 -std=c++20
+// usage: tests/bench_layout [num_keys] [zipf_s ...]   (defaults to 300 and 1.0 1.5 2.0)
+
+#include "../mhash_cpp.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+using Clock = chrono::high_resolution_clock;
+
+static vector<string> make_random_strings(size_t n, size_t len) {
+    static const char charset[] =
+        "abcdefghijklmnopqrstuvwxyz"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "0123456789";
+    mt19937_64 rng{12345};
+    uniform_int_distribution<size_t> dist(0, sizeof(charset) - 2);
+    vector<string> out;
+    out.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        string s;
+        for (size_t j = 0; j < len; ++j)
+            s.push_back(charset[dist(rng)]);
+        out.push_back(std::move(s));
+    }
+    return out;
+}
+
+// query stream where the key of popularity rank r (a random key) has weight 1/r^s
+static vector<const string*> make_zipf_queries(const vector<string>& keys, double s, size_t count) {
+    mt19937_64 rng{7};
+    vector<size_t> by_rank(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) by_rank[i] = i;
+    shuffle(by_rank.begin(), by_rank.end(), rng);
+    vector<double> weights(keys.size());
+    for (size_t r = 0; r < keys.size(); ++r) weights[r] = 1.0 / pow(double(r + 1), s);
+    discrete_distribution<size_t> dist(weights.begin(), weights.end());
+    vector<const string*> out(count);
+    for (auto& q : out) q = &keys[by_rank[dist(rng)]];
+    return out;
+}
+
+// cache lines holding the values that serve 95% of the queries
+static size_t hot_lines(MHashMap<int>& map, const vector<const string*>& queries) {
+    vector<pair<size_t, uintptr_t>> counts; // (hits, line)
+    {
+        vector<uintptr_t> lines;
+        for (auto* q : queries) lines.push_back(uintptr_t(map.get(*q)) / 64);
+        sort(lines.begin(), lines.end());
+        for (size_t i = 0; i < lines.size();) {
+            size_t j = i;
+            while (j < lines.size() && lines[j] == lines[i]) ++j;
+            counts.push_back({j - i, lines[i]});
+            i = j;
+        }
+    }
+    sort(counts.rbegin(), counts.rend());
+    size_t covered = 0, used = 0;
+    while (covered < queries.size() * 0.95) covered += counts[used++].first;
+    return used;
+}
+
+static double time_queries(MHashMap<int>& map, const vector<const string*>& queries, size_t& checksum) {
+    auto start = Clock::now();
+    for (size_t repeat = 0; repeat < 20; ++repeat)
+        for (auto* q : queries) checksum += *map.get(*q);
+    chrono::duration<double> t = Clock::now() - start;
+    return t.count() / (20 * queries.size()) * 1e9;
+}
+
+int main(int argc, char** argv) {
+    const size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 300;
+    vector<double> exponents;
+    for (int i = 2; i < argc; ++i) exponents.push_back(atof(argv[i]));
+    if (exponents.empty()) exponents = {1.0, 1.5, 2.0};
+    auto keys = make_random_strings(n, 16);
+
+    size_t checksum = 0;
+    cout << "| keys | zipf s | layout | table size | value lines for 95% | lookup |\n";
+    cout << "|------|--------|--------|------------|---------------------|--------|\n";
+    for (double s : exponents) {
+        auto queries = make_zipf_queries(keys, s, 1000000);
+        MHashMap<int> map;
+        for (size_t i = 0; i < n; ++i) map.insert(keys[i], int(i));
+        map.build();
+
+        double ns = time_queries(map, queries, checksum);
+        printf("| %zu | %.2f | insertion | %zu | %zu | %.1fns |\n", n, s, map.stats().table_size, hot_lines(map, queries), ns);
+
+        map.enable_sampling(16);
+        for (auto* q : queries) checksum += *map.get(*q);
+        map.optimize_layout();
+        map.enable_sampling(0);
+        ns = time_queries(map, queries, checksum);
+        printf("| %zu | %.2f | hot-first | %zu | %zu | %.1fns |\n", n, s, map.stats().table_size, hot_lines(map, queries), ns);
+    }
+    if (checksum == 0) cout << "checksum=0\n";
+    return 0;
+}
@@ -0,0 +1,154 @@
+// g++ tests/bench_nocase.cpp -o tests/bench_nocase -O3 -std=c++20
+// Case-insensitive lookup of HTTP request header names as they arrive: mostly canonical
+// ("Content-Type"), often lowercase (HTTP/2 and HTTP/3), sometimes in arbitrary case, with
+// 5% unknown names. Lowercasing each name into a scratch buffer before an exact lookup is
+// compared against the case-insensitive hash family and comparator, which fold as they go.
+
+#include "../mhash_cpp.h"
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cstring>
+
+using namespace std;
+using Clock = chrono::high_resolution_clock;
+
+#define N_LOOKUPS 1000000
+#define N_REPS    20
+
+// Pairs that share 16 or more leading bytes (e.g. the Access-Control-Request-* headers)
+// cannot be told apart by the prefix hashes, so only one of each is kept.
+static const char* headers[] = {
+    "Host", "User-Agent", "Accept", "Accept-Encoding", "Accept-Language", "Accept-Charset",
+    "Connection", "Keep-Alive", "Content-Type", "Content-Length", "Content-Encoding", "Cookie",
+    "Authorization", "Proxy-Authorization", "Cache-Control", "Pragma", "Referer", "Origin",
+    "If-None-Match", "If-Modified-Since", "If-Match", "If-Range", "Range", "Upgrade",
+    "Upgrade-Insecure-Requests", "DNT", "TE", "Via", "Forwarded", "X-Forwarded-For",
+    "X-Forwarded-Proto", "X-Forwarded-Host", "X-Real-IP", "X-Requested-With", "X-Request-ID",
+    "X-CSRF-Token", "Sec-Fetch-Mode", "Sec-Fetch-Site", "Sec-Fetch-Dest", "Sec-Fetch-User",
+    "Sec-CH-UA", "Sec-CH-UA-Mobile", "Sec-CH-UA-Platform", "Expect", "Date", "Transfer-Encoding",
+    "Priority", "Access-Control-Request-Method"};
+static constexpr size_t num_headers = sizeof(headers) / sizeof(headers[0]);
+
+static string lowercase(string s) {
+    for (auto& c : s)
+        c = (char)mhash_str_fold((unsigned char)c);
+    return s;
+}
+
+static vector<string> make_queries(mt19937& rng) {
+    vector<string> queries(N_LOOKUPS);
+    uniform_int_distribution<size_t> pick(0, num_headers - 1);
+    uniform_int_distribution<int> percent(0, 99), coin(0, 1);
+    for (auto& q : queries) {
+        const int style = percent(rng);
+        if (style < 5) {
+            q = "X-Custom-Header-" + to_string(pick(rng));
+            continue;
+        }
+        q = headers[pick(rng)];
+        if (style < 40)
+            q = lowercase(q);
+        else if (style < 50)
+            for (auto& c : q)
+                c = (char)(coin(rng) ? toupper((unsigned char)c) : tolower((unsigned char)c));
+    }
+    return queries;
+}
+
+template<typename F>
+static double best_ns(const vector<string>& queries, F&& lookup) {
+    double best = 1e30;
+    for (int rep = 0; rep < N_REPS; ++rep) {
+        auto start = Clock::now();
+        long long sum = 0;
+        for (const auto& q : queries)
+            sum += lookup(q);
+        auto end = Clock::now();
+        volatile long long sink = sum;
+        (void)sink;
+        best = min(best, chrono::duration<double, nano>(end - start).count() / queries.size());
+    }
+    return best;
+}
+
+// Builds a C map over the lowercase names with the smallest table that works.
+static bool build_c_map(MHash* map, vector<MHASH_INDEX_UINT>& table, const vector<const void*>& keys, mhash_func hash) {
+    for (size_t table_size = keys.size() * 3; table_size <= keys.size() * 128; table_size = table_size * 6 / 5 + 1) {
+        table.resize(table_size);
+        if (mhash_init(map, table.data(), table_size, const_cast<const void**>(keys.data()), keys.size(), hash) == MHASH_OK)
+            return true;
+    }
+    return false;
+}
+
+int main() {
+    mt19937 rng(42);
+    const vector<string> queries = make_queries(rng);
+
+    MHashMap<int> exact, nocase(mhash_case_insensitive);
+    unordered_map<string, int> reference;
+    vector<string> lower(num_headers);
+    vector<const void*> lower_ptrs(num_headers);
+    vector<int> values(num_headers);
+    for (size_t i = 0; i < num_headers; ++i) {
+        lower[i] = lowercase(headers[i]);
+        lower_ptrs[i] = lower[i].c_str();
+        values[i] = (int)i;
+        exact.insert(lower[i], (int)i);
+        nocase.insert(headers[i], (int)i);
+        reference[lower[i]] = (int)i;
+    }
+    exact.build();
+    nocase.build();
+
+    MHash c_exact, c_nocase;
+    vector<MHASH_INDEX_UINT> exact_table, nocase_table;
+    if (!build_c_map(&c_exact, exact_table, lower_ptrs, mhash_str_prefix)
+        || !build_c_map(&c_nocase, nocase_table, lower_ptrs, mhash_str_prefix_nocase)) {
+        cerr << "Failed to build C maps" << endl;
+        return 1;
+    }
+
+    cout << num_headers << " header names, " << c_nocase.table_size << " slots, " << c_nocase.num_hashes << " hashes" << endl;
+    cout << "| lookup | ns/lookup |" << endl;
+    cout << "|--------|-----------|" << endl;
+    auto row = [](const char* name, double ns) { cout << "| " << name << " | " << ns << " |" << endl; };
+
+    string scratch;
+    char buffer[64];
+    row("lowercase copy + unordered_map::find", best_ns(queries, [&](const string& q) {
+        scratch.assign(q);
+        for (auto& c : scratch)
+            c = (char)mhash_str_fold((unsigned char)c);
+        auto it = reference.find(scratch);
+        return it == reference.end() ? -1 : it->second;
+    }));
+    row("lowercase copy + MHashMap::get", best_ns(queries, [&](const string& q) {
+        scratch.assign(q);
+        for (auto& c : scratch)
+            c = (char)mhash_str_fold((unsigned char)c);
+        const int* v = exact.get(scratch);
+        return v ? *v : -1;
+    }));
+    row("case-insensitive MHashMap::get", best_ns(queries, [&](const string& q) {
+        const int* v = nocase.get(q);
+        return v ? *v : -1;
+    }));
+    row("lowercase copy + mhash_check_at", best_ns(queries, [&](const string& q) {
+        const size_t len = min(q.size(), sizeof(buffer) - 1);
+        for (size_t i = 0; i < len; ++i)
+            buffer[i] = (char)mhash_str_fold((unsigned char)q[i]);
+        buffer[len] = 0;
+        const int* v = (const int*)mhash_check_at(&c_exact, buffer, lower_ptrs.data(), values.data(), sizeof(int), mhash_strcmp);
+        return v ? *v : -1;
+    }));
+    row("mhash_check_at, _nocase hash + mhash_strcasecmp", best_ns(queries, [&](const string& q) {
+        const int* v = (const int*)mhash_check_at(&c_nocase, q.c_str(), lower_ptrs.data(), values.data(), sizeof(int), mhash_strcasecmp);
+        return v ? *v : -1;
+    }));
+    return 0;
+}
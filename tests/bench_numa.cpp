@@ -0,0 +1,67 @@
+// g++ tests/bench_numa.cpp -o tests/bench_numa -O3 -std=c++20 -pthread -DMHASH_NUMA -lnuma
+
+#include "../mhash_shard.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+
+using namespace std;
+using Clock = chrono::high_resolution_clock;
+
+static vector<string> make_random_strings(size_t n, size_t len) {
+    static const char charset[] =
+        "abcdefghijklmnopqrstuvwxyz"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "0123456789";
+    mt19937_64 rng{12345};
+    uniform_int_distribution<size_t> dist(0, sizeof(charset) - 2);
+
+    vector<string> out;
+    out.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        string s;
+        s.reserve(len);
+        for (size_t j = 0; j < len; ++j)
+            s.push_back(charset[dist(rng)]);
+        out.push_back(std::move(s));
+    }
+    return out;
+}
+
+static double lookup_ns(const MHashShardedMap<uint32_t>& map, const vector<string>& keys) {
+    constexpr size_t N_LOOKUPS = 5000000;
+    mt19937_64 rng(42);
+    size_t checksum = 0;
+    auto start = Clock::now();
+    for (size_t i = 0; i < N_LOOKUPS; ++i)
+        checksum += *map.get(keys[rng() % keys.size()]);
+    chrono::duration<double> elapsed = Clock::now() - start;
+    if (checksum == 0) cout << "checksum=0\n";
+    return elapsed.count() / N_LOOKUPS * 1e9;
+}
+
+int main() {
+    if (numa_available() < 0) {
+        cout << "NUMA is not available on this system.\n";
+        return 0;
+    }
+    const int last_node = numa_max_node();
+    constexpr size_t N = 1000000;
+    auto keys = make_random_strings(N, 16);
+
+    // build on node 0, then look up from the last node
+    numa_run_on_node(0);
+    MHashShardedMap<uint32_t> map;
+    for (size_t i = 0; i < N; ++i)
+        map.insert(keys[i], uint32_t(i));
+    map.build(1);
+    numa_run_on_node(last_node);
+
+    cout << "Lookups on node " << last_node << " into tables built on node 0\n";
+    cout << "shared tables:     " << lookup_ns(map, keys) << " ns\n";
+    map.replicate_numa();
+    cout << "node-local tables: " << lookup_ns(map, keys) << " ns (" << map.num_replicas() << " replicas)\n";
+    return 0;
+}
@@ -0,0 +1,111 @@
+// g++ tests/bench_shard.cpp -o tests/bench_shard -O3 -std=c++20 -pthread
+// usage: tests/bench_shard [num_keys ...]   (defaults to 1M 10M 50M)
+// add -DMHASH_HUGE_THRESHOLD=SIZE_MAX to compare dTLB misses against regular pages
+
+#include "../mhash_shard.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+using Clock = chrono::high_resolution_clock;
+
+static vector<string> make_unique_strings(size_t n, size_t len) {
+    static const char charset[] =
+        "abcdefghijklmnopqrstuvwxyz"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "0123456789";
+    constexpr size_t charset_size = sizeof(charset) - 1;
+    mt19937_64 rng{12345};
+    uniform_int_distribution<size_t> dist(0, charset_size - 1);
+
+    vector<string> out;
+    out.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        string s(len, ' ');
+        // random prefix followed by a unique base-62 suffix
+        for (size_t j = 0; j < len - 5; ++j)
+            s[j] = charset[dist(rng)];
+        size_t x = i;
+        for (size_t j = len; j-- > len - 5;) {
+            s[j] = charset[x % charset_size];
+            x /= charset_size;
+        }
+        out.push_back(std::move(s));
+    }
+    return out;
+}
+
+// counts dTLB read misses of this thread; returns -1 where perf events are unavailable
+static int open_dtlb_counter() {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB
+                | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int main(int argc, char** argv) {
+    vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i)
+        sizes.push_back(strtoull(argv[i], nullptr, 10));
+    if (sizes.empty())
+        sizes = {1000000, 10000000, 50000000};
+    constexpr size_t N_LOOKUPS = 10000000;
+
+    const int dtlb = open_dtlb_counter();
+
+    cout << "| keys | threads | build keys/s | lookup | shards | table x8B/key | backing | dTLB misses/lookup |\n";
+    cout << "|------|---------|--------------|--------|--------|---------------|---------|--------------------|\n";
+    for (size_t n : sizes) {
+        auto keys = make_unique_strings(n, 16);
+        MHashShardedMap<uint32_t> map;
+        for (size_t i = 0; i < n; ++i)
+            map.insert(keys[i], uint32_t(i));
+
+        const unsigned threads = max(1u, thread::hardware_concurrency());
+        auto start = Clock::now();
+        map.build(threads);
+        chrono::duration<double> build_time = Clock::now() - start;
+
+        mt19937_64 rng(42);
+        uniform_int_distribution<size_t> dist(0, n - 1);
+        size_t checksum = 0;
+        if (dtlb >= 0) {
+            ioctl(dtlb, PERF_EVENT_IOC_RESET, 0);
+            ioctl(dtlb, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        start = Clock::now();
+        for (size_t i = 0; i < N_LOOKUPS; ++i)
+            checksum += *map.get(keys[dist(rng)]);
+        chrono::duration<double> lookup_time = Clock::now() - start;
+        uint64_t misses = 0;
+        if (dtlb >= 0) {
+            ioctl(dtlb, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(dtlb, &misses, sizeof(misses)) != sizeof(misses)) misses = 0;
+        }
+
+        char misses_text[32] = "n/a";
+        if (dtlb >= 0)
+            snprintf(misses_text, sizeof(misses_text), "%.2f", double(misses) / N_LOOKUPS);
+        printf("| %zu | %u | %.2fM | %.0fns | %zu | %.2f | %s | %s |\n",
+               n, threads, n / build_time.count() * 1e-6,
+               lookup_time.count() / N_LOOKUPS * 1e9,
+               map.num_shards(), double(map.table_size()) / n,
+               mhash_backing_name(map.stats().table_backing), misses_text);
+        if (checksum == 0) cout << "checksum=0\n";
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+// g++ tests/bench_small.cpp -o tests/bench_small -O3 -std=c++20
+// usage: tests/bench_small [num_maps]   (defaults to 20000)
+// Many tiny per-object maps: memory per map (object plus heap) and lookup latency over
+// random (map, field) pairs, for SmallMHashMap against MHashMap.
+
+#include "../mhash_cpp.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <malloc.h>
+
+using namespace std;
+using Clock = chrono::high_resolution_clock;
+
+// live heap bytes (glibc), which also covers the posix_memalign blocks of mhash_alloc
+static size_t heap_bytes() { return mallinfo2().uordblks; }
+
+static const vector<string> fields = {"id", "name", "email", "status", "created_at", "score", "owner_id", "region"};
+
+template<typename Map>
+static void fill(Map& map, size_t num_fields, int base) {
+    for (size_t f = 0; f < num_fields; ++f)
+        map.insert(fields[f], base + int(f));
+}
+static void fill(MHashMap<int>& map, size_t num_fields, int base) {
+    for (size_t f = 0; f < num_fields; ++f)
+        map.insert(fields[f], base + int(f));
+    map.build();
+}
+
+template<typename Map>
+static void run(const char* name, size_t num_maps, size_t num_fields) {
+    vector<Map> maps(num_maps);
+    const size_t heap_before = heap_bytes();
+    for (size_t m = 0; m < num_maps; ++m)
+        fill(maps[m], num_fields, int(m));
+    const double bytes_per_map = double(heap_bytes() - heap_before) / num_maps + sizeof(Map);
+
+    constexpr size_t N_LOOKUPS = 5000000;
+    mt19937_64 rng(42);
+    vector<pair<uint32_t, uint8_t>> queries(N_LOOKUPS);
+    for (auto& q : queries) q = {uint32_t(rng() % num_maps), uint8_t(rng() % num_fields)};
+    size_t checksum = 0;
+    auto start = Clock::now();
+    for (auto& q : queries)
+        checksum += *maps[q.first].get(fields[q.second]);
+    chrono::duration<double> t = Clock::now() - start;
+    printf("| %s | %zu | %zu | %.0fB | %.1fns |\n", name, num_maps, num_fields, bytes_per_map, t.count() / N_LOOKUPS * 1e9);
+    if (checksum == 0) cout << "checksum=0\n";
+}
+
+int main(int argc, char** argv) {
+    const size_t num_maps = argc > 1 ? strtoull(argv[1], nullptr, 10) : 20000;
+    cout << "| map | maps | fields | bytes/map | lookup |\n";
+    cout << "|-----|------|--------|-----------|--------|\n";
+    for (size_t num_fields : {3, 6, 8}) {
+        run<SmallMHashMap<int, 8>>("SmallMHashMap<int, 8>", num_maps, num_fields);
+        run<MHashMap<int>>("MHashMap<int>", num_maps, num_fields);
+    }
+    return 0;
+}
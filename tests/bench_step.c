@@ -0,0 +1,103 @@
+// COMPILE WITH: gcc tests/bench_step.c -o tests/bench_step -O3 -lm
+
+#define MHASH_NO_WORST_CASE
+
+#include "../mhash.h"
+#include "../mhash_str.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define N_KEYS     2000
+#define TABLE_SIZE (1 << 22)
+#define BUDGET     4096
+#define N_BUILDS   20
+#define MAX_ITERS  1000000
+
+static inline double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char **make_keys(size_t n) {
+    static const char charset[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz"
+        "0123456789";
+    size_t charset_size = sizeof(charset) - 1;
+    char **keys = malloc(n * sizeof(char *));
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = malloc(17);
+        for (int j = 0; j < 12; ++j)
+            keys[i][j] = charset[rand() % charset_size];
+        size_t x = i;
+        for (int j = 15; j >= 12; --j) {
+            keys[i][j] = charset[x % charset_size];
+            x /= charset_size;
+        }
+        keys[i][16] = '\0';
+    }
+    return keys;
+}
+
+// stands in for the I/O handled by one event loop iteration
+static volatile unsigned io_sink;
+static void handle_io(void) {
+    for (unsigned i = 0; i < 200; ++i)
+        io_sink += i;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *name, double *lat, size_t n, double build_time) {
+    qsort(lat, n, sizeof(double), cmp_double);
+    printf("| %-9s | %10zu | %7.1fus | %7.1fus | %8.1fus | %8.2fms |\n", name, n,
+           lat[n / 2] * 1e6, lat[(size_t)(n * 0.99)] * 1e6, lat[n - 1] * 1e6, build_time * 1e3);
+}
+
+int main(void) {
+    srand(42);
+    char **keys = make_keys(N_KEYS);
+    MHASH_INDEX_UINT *table = malloc(TABLE_SIZE * sizeof(MHASH_INDEX_UINT));
+    double *lat = malloc(MAX_ITERS * sizeof(double));
+
+    printf("| build     | loop iters | p50       | p99       | max        | build time |\n");
+    printf("|-----------|------------|-----------|-----------|------------|------------|\n");
+    for (int stepped = 0; stepped <= 1; ++stepped) {
+        size_t iters = 0;
+        double build_time = 0;
+        for (int b = 0; b < N_BUILDS; ++b) {
+            MHash map;
+            MHashBuilder builder = {0};
+            int status = MHASH_PENDING;
+            double build_start = now_sec();
+            if (stepped)
+                mhash_build_begin(&builder, &map, table, TABLE_SIZE, (const void **)keys, N_KEYS, mhash_str_prefix);
+            while (status == MHASH_PENDING && iters < MAX_ITERS) {
+                double start = now_sec();
+                handle_io();
+                if (stepped)
+                    status = mhash_build_step(&builder, BUDGET);
+                else
+                    status = mhash_init(&map, table, TABLE_SIZE, (const void **)keys, N_KEYS, mhash_str_prefix);
+                lat[iters++] = now_sec() - start;
+            }
+            build_time += now_sec() - build_start;
+            if (status != MHASH_OK)
+                printf("Warning: build %d failed\n", b);
+        }
+        report(stepped ? "stepped" : "blocking", lat, iters, build_time / N_BUILDS);
+    }
+
+    free(lat);
+    free(table);
+    for (size_t i = 0; i < N_KEYS; ++i)
+        free(keys[i]);
+    free(keys);
+    return 0;
+}
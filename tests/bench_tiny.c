@@ -0,0 +1,108 @@
+// COMPILE WITH: gcc tests/bench_tiny.c -o tests/bench_tiny -O3 -lm
+
+#define MHASH_NO_WORST_CASE
+
+#include "../mhash.h"
+#include "../mhash_str.h"
+#include "../mhash_tiny.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define N_LOOKUPS 1000000
+#define N_REPS    20
+
+static inline double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ------------------- Unique key generator -------------------
+static char **make_keys(size_t n) {
+    static const char charset[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz"
+        "0123456789";
+    size_t charset_size = sizeof(charset) - 1;
+    char **keys = malloc(n * sizeof(char *));
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = malloc(17);
+        for (int j = 0; j < 12; ++j)
+            keys[i][j] = charset[rand() % charset_size];
+        size_t x = i;
+        for (int j = 15; j >= 12; --j) {
+            keys[i][j] = charset[x % charset_size];
+            x /= charset_size;
+        }
+        keys[i][16] = '\0';
+    }
+    return keys;
+}
+
+static void free_keys(char **keys, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        free(keys[i]);
+    free(keys);
+}
+
+// ------------------- Benchmark -------------------
+int main(void) {
+    srand(42);
+    static const size_t sizes[] = {2, 4, 8, 16, 32, 64, 90, 128, 200, 255};
+    size_t *queries = malloc(N_LOOKUPS * sizeof(size_t));
+
+    printf("| keys | mhash | tiny | mhash table | tiny bytes | tiny prefix |\n");
+    printf("|------|-------|------|-------------|------------|-------------|\n");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        const size_t n = sizes[s];
+        double mhash_ns = 0, tiny_ns = 0, tiny_bytes = 0, tiny_prefix = 0, mhash_bytes = 0;
+        int ok_runs = 0;
+        for (int rep = 0; rep < N_REPS; ++rep) {
+            char **keys = make_keys(n);
+            int *values = malloc(n * sizeof(int));
+            for (size_t i = 0; i < n; ++i) values[i] = (int)i + 1;
+            for (size_t i = 0; i < N_LOOKUPS; ++i) queries[i] = rand() % n;
+
+            // same table search as tests/bench.c
+            size_t table_size = n * 3;
+            MHASH_INDEX_UINT *table = malloc(table_size * sizeof(MHASH_INDEX_UINT));
+            MHash map = {0};
+            MHashTiny tiny;
+            int ok = 0;
+            for (;;) {
+                ok = mhash_init(&map, table, table_size, (const void **)keys, n, mhash_str_prefix) == MHASH_OK;
+                if (ok || table_size > 65536) break;
+                table_size = table_size < 16 ? table_size + 1 : (size_t)(table_size * 1.2) + 1;
+                table = realloc(table, table_size * sizeof(MHASH_INDEX_UINT));
+            }
+            if (ok && mhash_tiny_init(&tiny, (const void **)keys, n) == MHASH_OK) {
+                volatile int sink = 0;
+                double start = now_sec();
+                for (size_t i = 0; i < N_LOOKUPS; ++i)
+                    sink += *(int *)mhash_check_at(&map, keys[queries[i]], (const void **)keys, values, sizeof(int), mhash_strcmp);
+                mhash_ns += (now_sec() - start) / N_LOOKUPS * 1e9;
+                start = now_sec();
+                for (size_t i = 0; i < N_LOOKUPS; ++i)
+                    sink += *(int *)mhash_tiny_check_at(&tiny, keys[queries[i]], (const void **)keys, values, sizeof(int), mhash_strcmp);
+                tiny_ns += (now_sec() - start) / N_LOOKUPS * 1e9;
+                tiny_bytes += (double)mhash_tiny_bytes(&tiny);
+                tiny_prefix += tiny.params.prefix;
+                mhash_bytes += (double)(table_size * sizeof(MHASH_INDEX_UINT));
+                ok_runs++;
+            }
+            free(table);
+            free(values);
+            free_keys(keys, n);
+        }
+        if (!ok_runs) {
+            printf("| %zu | FAILED |\n", n);
+            continue;
+        }
+        printf("| %4zu | %4.1fns | %4.1fns | %7.0fB | %6.0fB | %4.1f |\n", n, mhash_ns / ok_runs, tiny_ns / ok_runs,
+               mhash_bytes / ok_runs, tiny_bytes / ok_runs, tiny_prefix / ok_runs);
+    }
+    free(queries);
+    return 0;
+}
@@ -0,0 +1,196 @@
+// COMPILE WITH: gcc tests/bench_typed.c -o tests/bench_typed -O3 -lm
+
+#define MHASH_NO_WORST_CASE
+
+#include "../mhash.h"
+#include "../mhash_str.h"
+#include "../mhash_typed.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define N_LOOKUPS 1000000
+#define N_REPS    20
+
+typedef struct Value {
+    double weight;
+    int id;
+} Value;
+
+static inline double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// A hash family and comparator for integer keys, taken by value and through pointers.
+static inline MHASH_UINT hash_u64(uint64_t key, MHASH_UINT id) {
+    uint64_t h = (key ^ (0x9E3779B97F4A7C15ULL * id)) * 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 31);
+}
+static inline int cmp_u64(uint64_t a, uint64_t b) {
+    return a != b;
+}
+static MHASH_UINT hash_u64_ptr(const void *key, MHASH_UINT id) {
+    return hash_u64(*(const uint64_t *)key, id);
+}
+static int cmp_u64_ptr(const void *a, const void *b) {
+    return *(const uint64_t *)a != *(const uint64_t *)b;
+}
+
+MHASH_DEFINE_MAP(str_map, const char *, Value, mhash_str_prefix, mhash_strcmp)
+MHASH_DEFINE_MAP(u64_map, uint64_t, Value, hash_u64, cmp_u64)
+
+// ------------------- Unique key generator -------------------
+static char **make_keys(size_t n) {
+    static const char charset[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz"
+        "0123456789";
+    size_t charset_size = sizeof(charset) - 1;
+    char **keys = malloc(n * sizeof(char *));
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = malloc(17);
+        for (int j = 0; j < 12; ++j)
+            keys[i][j] = charset[rand() % charset_size];
+        size_t x = i;
+        for (int j = 15; j >= 12; --j) {
+            keys[i][j] = charset[x % charset_size];
+            x /= charset_size;
+        }
+        keys[i][16] = '\0';
+    }
+    return keys;
+}
+
+static void free_keys(char **keys, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        free(keys[i]);
+    free(keys);
+}
+
+static void report(const char *kind, size_t n, MHASH_UINT num_hashes, const double *best) {
+    printf("| %s | %5zu | %2llu | %8.2f ns | %8.2f ns | %8.2f ns | %8.2f ns |\n", kind, n,
+           (unsigned long long)num_hashes, best[0] * 1e9 / N_LOOKUPS, best[1] * 1e9 / N_LOOKUPS,
+           best[2] * 1e9 / N_LOOKUPS, best[3] * 1e9 / N_LOOKUPS);
+}
+
+// ------------------- Benchmark -------------------
+int main(void) {
+    srand(42);
+    static const size_t sizes[] = {16, 64, 256, 1024};
+    size_t *queries = malloc(N_LOOKUPS * sizeof(size_t));
+    const void **generic_queries = malloc(N_LOOKUPS * sizeof(void *));
+    void **generic_results = malloc(N_LOOKUPS * sizeof(void *));
+    Value **typed_results = malloc(N_LOOKUPS * sizeof(Value *));
+
+    printf("| keys | count | hashes | check_at | typed get | check_at_batch | typed batch |\n");
+    printf("|------|-------|--------|----------|-----------|----------------|-------------|\n");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        const size_t n = sizes[s];
+        char **keys = make_keys(n);
+        uint64_t *ints = malloc(n * sizeof(uint64_t));
+        const void **int_ptrs = malloc(n * sizeof(void *));
+        uint64_t *int_queries = malloc(N_LOOKUPS * sizeof(uint64_t));
+        const char **str_queries = malloc(N_LOOKUPS * sizeof(char *));
+        Value *values = malloc(n * sizeof(Value));
+        MHASH_INDEX_UINT *table = NULL, *typed_table = NULL;
+        for (size_t i = 0; i < n; ++i) {
+            ints[i] = ((uint64_t)rand() << 32) ^ (uint64_t)rand() ^ i;
+            int_ptrs[i] = &ints[i];
+            values[i].weight = (double)i;
+            values[i].id = (int)i;
+        }
+        for (size_t i = 0; i < N_LOOKUPS; ++i) {
+            queries[i] = (size_t)rand() % n;
+            str_queries[i] = keys[queries[i]];
+            int_queries[i] = ints[queries[i]];
+        }
+
+        for (int kind = 0; kind < 2; ++kind) {
+            // quadratic table (few hashes), grown until both maps build
+            MHash map = {0};
+            str_map smap = {0};
+            u64_map imap = {0};
+            int failed = 1;
+            for (size_t table_size = n * n / 2 + 64; failed && table_size <= 4 * n * n;
+                 table_size = (size_t)(table_size * 1.2) + 1) {
+                table = realloc(table, table_size * sizeof(MHASH_INDEX_UINT));
+                typed_table = realloc(typed_table, table_size * sizeof(MHASH_INDEX_UINT));
+                if (kind == 0)
+                    failed = mhash_init(&map, table, table_size, (const void **)keys, n, mhash_str_prefix)
+                          || str_map_init(&smap, typed_table, table_size, (const char *const *)keys, values, n);
+                else
+                    failed = mhash_init(&map, table, table_size, int_ptrs, n, hash_u64_ptr)
+                          || u64_map_init(&imap, typed_table, table_size, ints, values, n);
+            }
+            if (failed) {
+                printf("Failed to create map of %zu keys\n", n);
+                continue;
+            }
+            int (*cmp)(const void *, const void *) = kind == 0 ? mhash_strcmp : cmp_u64_ptr;
+            for (size_t i = 0; i < N_LOOKUPS; ++i)
+                generic_queries[i] = kind == 0 ? (const void *)str_queries[i] : (const void *)&int_queries[i];
+
+            double best[4] = {1e30, 1e30, 1e30, 1e30};
+            volatile long long sink = 0;
+            for (int rep = 0; rep < N_REPS; ++rep) {
+                long long sum = 0;
+                double t0 = now_sec();
+                for (size_t i = 0; i < N_LOOKUPS; ++i) {
+                    Value *v = (Value *)mhash_check_at(&map, generic_queries[i], kind == 0 ? (const void **)keys : int_ptrs,
+                                                       values, sizeof(Value), cmp);
+                    sum += v ? v->id : -1;
+                }
+                double t1 = now_sec();
+                if (kind == 0)
+                    for (size_t i = 0; i < N_LOOKUPS; ++i) {
+                        Value *v = str_map_get(&smap, str_queries[i]);
+                        sum -= v ? v->id : -1;
+                    }
+                else
+                    for (size_t i = 0; i < N_LOOKUPS; ++i) {
+                        Value *v = u64_map_get(&imap, int_queries[i]);
+                        sum -= v ? v->id : -1;
+                    }
+                double t2 = now_sec();
+                mhash_check_at_batch(&map, generic_queries, N_LOOKUPS, kind == 0 ? (const void **)keys : int_ptrs,
+                                     values, sizeof(Value), cmp, generic_results);
+                for (size_t i = 0; i < N_LOOKUPS; ++i)
+                    sum += generic_results[i] ? ((Value *)generic_results[i])->id : -1;
+                double t3 = now_sec();
+                if (kind == 0)
+                    str_map_get_batch(&smap, str_queries, N_LOOKUPS, typed_results);
+                else
+                    u64_map_get_batch(&imap, int_queries, N_LOOKUPS, typed_results);
+                for (size_t i = 0; i < N_LOOKUPS; ++i)
+                    sum -= typed_results[i] ? typed_results[i]->id : -1;
+                double t4 = now_sec();
+                if (sum != 0) {
+                    printf("Typed and generic lookups disagree\n");
+                    return 1;
+                }
+                sink += sum;
+                const double t[4] = {t1 - t0, t2 - t1, t3 - t2, t4 - t3};
+                for (int k = 0; k < 4; ++k)
+                    if (t[k] < best[k]) best[k] = t[k];
+            }
+            report(kind == 0 ? "str" : "u64", n, map.num_hashes, best);
+        }
+
+        free_keys(keys, n);
+        free(ints);
+        free(int_ptrs);
+        free(int_queries);
+        free(str_queries);
+        free(values);
+        free(table);
+        free(typed_table);
+    }
+    free(queries);
+    free(generic_queries);
+    free(generic_results);
+    free(typed_results);
+    return 0;
+}
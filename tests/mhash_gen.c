@@ -0,0 +1,186 @@
+// COMPILE WITH: gcc tests/mhash_gen.c -o tests/mhash_gen -O2
+// USAGE: tests/mhash_gen <keys.txt> <name> <output prefix> [table size]
+//
+// Offline generator for key sets known ahead of time. Reads one key per line, runs the
+// mhash_init search with mhash_str_prefix and writes <prefix>.h and <prefix>.c with the
+// table as a static const array, the hash levels unrolled with a constant level count and
+// table size, and `int <name>_lookup(const char *s, size_t len)` returning the key's line
+// number (among non-empty lines) or -1. The generated code does not include mhash.h.
+
+#include "../mhash.h"
+#include "../mhash_str.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char **read_keys(const char *path, size_t *count) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    size_t capacity = 64, n = 0, len = 0, line_capacity = 64;
+    char **keys = malloc(capacity * sizeof(char *));
+    char *line = malloc(line_capacity);
+    int c;
+    do {
+        c = fgetc(f);
+        if (c != EOF && c != '\n') {
+            if (len + 1 == line_capacity)
+                line = realloc(line, line_capacity *= 2);
+            line[len++] = (char)c;
+            continue;
+        }
+        if (len && line[len - 1] == '\r') --len;
+        if (!len) continue;
+        if (n == capacity)
+            keys = realloc(keys, (capacity *= 2) * sizeof(char *));
+        keys[n] = malloc(len + 1);
+        memcpy(keys[n], line, len);
+        keys[n++][len] = '\0';
+        len = 0;
+    } while (c != EOF);
+    free(line);
+    fclose(f);
+    *count = n;
+    return keys;
+}
+
+// The table size search of MHashMap::build, or a single attempt at forced_size slots.
+static int search(MHash *ph, MHASH_INDEX_UINT **table, const char **keys, size_t count, size_t forced_size) {
+    if (!forced_size) {
+        const MHashKeySource source = {(const void **)keys, NULL, NULL, NULL, NULL};
+        return mhash__search_table_size(ph, table, count, mhash_str_prefix, &source);
+    }
+    *table = realloc(*table, forced_size * sizeof(MHASH_INDEX_UINT));
+    return mhash_init(ph, *table, forced_size, (const void **)keys, count, mhash_str_prefix);
+}
+
+static void put_literal(FILE *out, const char *s) {
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *)s; *p; ++p) {
+        if (*p == '"' || *p == '\\' || *p == '?') fprintf(out, "\\%c", *p);
+        else if (*p < 0x20 || *p >= 0x7f) fprintf(out, "\\%03o", *p);
+        else fputc(*p, out);
+    }
+    fputc('"', out);
+}
+
+static FILE *open_output(const char *prefix, const char *extension) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s%s", prefix, extension);
+    FILE *out = fopen(path, "wb");
+    if (!out) fprintf(stderr, "cannot write %s\n", path);
+    return out;
+}
+
+static void write_header(FILE *out, const char *name, const char *upper, size_t count) {
+    fprintf(out, "// Generated by tests/mhash_gen.c. Do not edit.\n\n");
+    fprintf(out, "#ifndef %s_H\n#define %s_H\n\n", upper, upper);
+    fprintf(out, "#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n");
+    fprintf(out, "#include <stddef.h>\n\n");
+    fprintf(out, "#define %s_COUNT %zu\n\n", upper, count);
+    fprintf(out, "extern const char *const %s_keys[%zu];\n\n", name, count ? count : 1);
+    fprintf(out, "// Id (position in the key list) of the len bytes at s, or -1 if they are not a key.\n");
+    fprintf(out, "int %s_lookup(const char *s, size_t len);\n\n", name);
+    fprintf(out, "#ifdef __cplusplus\n}\n#endif\n\n#endif // %s_H\n", upper);
+}
+
+static void write_source(FILE *out, const char *name, const char *header, const MHash *ph, const char **keys, size_t count) {
+    const char *index_type = count < 0xFF ? "uint8_t" : count < 0xFFFF ? "uint16_t" : "uint32_t";
+    const unsigned long long empty = count < 0xFF ? 0xFF : count < 0xFFFF ? 0xFFFF : 0xFFFFFFFF;
+    fprintf(out, "// Generated by tests/mhash_gen.c. Do not edit.\n");
+    fprintf(out, "// %zu keys, %zu slots, %llu hash levels.\n\n", count, ph->table_size, (unsigned long long)ph->num_hashes);
+    fprintf(out, "#include \"%s\"\n#include <stdint.h>\n#include <string.h>\n\n", header);
+    fprintf(out, "#define %s__TABLE_SIZE %zuu\n", name, ph->table_size);
+    fprintf(out, "#define %s__EMPTY %lluu\n\n", name, empty);
+
+    fprintf(out, "const char *const %s_keys[%zu] = {\n", name, count ? count : 1);
+    for (size_t i = 0; i < count; ++i) {
+        fprintf(out, "    ");
+        put_literal(out, keys[i]);
+        fprintf(out, ",\n");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const uint16_t %s__lengths[%zu] = {", name, count ? count : 1);
+    for (size_t i = 0; i < count; ++i)
+        fprintf(out, "%s%zu,", i % 16 ? " " : "\n    ", strlen(keys[i]));
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "static const %s %s__table[%s__TABLE_SIZE] = {", index_type, name, name);
+    for (size_t i = 0; i < ph->table_size; ++i) {
+        const MHASH_INDEX_UINT entry = ph->table[i];
+        if (entry == MHASH_EMPTY_SLOT) fprintf(out, "%s%s__EMPTY,", i % 8 ? " " : "\n    ", name);
+        else fprintf(out, "%s%llu,", i % 8 ? " " : "\n    ", (unsigned long long)entry);
+    }
+    fprintf(out, "\n};\n\n");
+
+    // mhash_str_prefix with a constant level; the loop fully unrolls
+    fprintf(out, "static inline uint64_t %s__level(const char *s, size_t len, uint64_t id) {\n", name);
+    fprintf(out, "    uint64_t h = 0x9E3779B97F4A7C15ULL * id;\n");
+    fprintf(out, "    for (size_t i = 0; i < id && i < len; ++i) {\n");
+    fprintf(out, "        char c = s[i];\n");
+    fprintf(out, "        if (c == 0) break;\n");
+    fprintf(out, "        h ^= (uint64_t)(c + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2));\n");
+    fprintf(out, "    }\n    return h;\n}\n\n");
+
+    fprintf(out, "int %s_lookup(const char *s, size_t len) {\n", name);
+    fprintf(out, "    const uint64_t h = 0");
+    for (MHASH_UINT i = 1; i <= ph->num_hashes; ++i)
+        fprintf(out, "\n        ^ %s__level(s, len, %llu)", name, (unsigned long long)i);
+    fprintf(out, ";\n");
+    fprintf(out, "    const unsigned entry = %s__table[h %% %s__TABLE_SIZE];\n", name, name);
+    fprintf(out, "    if (entry == %s__EMPTY || %s__lengths[entry] != len || memcmp(%s_keys[entry], s, len))\n", name, name, name);
+    fprintf(out, "        return -1;\n");
+    fprintf(out, "    return (int)entry;\n}\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4 || argc > 5) {
+        fprintf(stderr, "usage: %s <keys.txt> <name> <output prefix> [table size]\n", argv[0]);
+        return 1;
+    }
+    const char *name = argv[2], *prefix = argv[3];
+    const size_t forced_size = argc == 5 ? (size_t)strtoull(argv[4], NULL, 10) : 0;
+    size_t count = 0;
+    char **keys = read_keys(argv[1], &count);
+    if (!keys) {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 1;
+    }
+    for (size_t i = 0; i < count; ++i)
+        if (strlen(keys[i]) > 0xFFFF) {
+            fprintf(stderr, "key %zu is longer than 65535 bytes\n", i);
+            return 1;
+        }
+
+    MHash ph;
+    MHASH_INDEX_UINT *table = NULL;
+    if (search(&ph, &table, (const char **)keys, count, forced_size) != MHASH_OK) {
+        fprintf(stderr, "Failed to build map: either too many collisions, too many keys, or duplicate keys.\n");
+        return 1;
+    }
+
+    // include path from the output prefix, macro names from the map name
+    const char *base = strrchr(prefix, '/');
+    base = base ? base + 1 : prefix;
+    char header[4096], upper[4096];
+    snprintf(header, sizeof(header), "%s.h", base);
+    size_t u = 0;
+    for (const char *p = name; *p && u + 1 < sizeof(upper); ++p)
+        upper[u++] = (*p >= 'a' && *p <= 'z') ? (char)(*p - 'a' + 'A') : *p;
+    upper[u] = '\0';
+
+    FILE *h = open_output(prefix, ".h");
+    FILE *c = open_output(prefix, ".c");
+    if (!h || !c) return 1;
+    write_header(h, name, upper, count);
+    write_source(c, name, header, &ph, (const char **)keys, count);
+    fclose(h);
+    fclose(c);
+    fprintf(stderr, "%zu keys, %zu slots, %llu hash levels\n", count, ph.table_size, (unsigned long long)ph.num_hashes);
+
+    for (size_t i = 0; i < count; ++i)
+        free(keys[i]);
+    free(keys);
+    free(table);
+    return 0;
+}
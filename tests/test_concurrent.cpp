@@ -0,0 +1,161 @@
+// g++ tests/test_concurrent.cpp -o tests/test_concurrent -O1 -g -std=c++20 -pthread
+// Edge cases of the snapshot maps in mhash_concurrent.h.
+
+#include "../mhash_concurrent.h"
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static void test_empty_maps() {
+    MHashMap<int> unbuilt, hashed(0);
+    hashed.build();
+    for (MHashMap<int>* map : {&unbuilt, &hashed}) {
+        assert(!map->get("missing"));
+        assert(map->id("missing") == SIZE_MAX);
+        const string keys[2] = {"a", "b"};
+        int* out[2] = {};
+        map->get_many(keys, 2, out);
+        assert(!out[0] && !out[1]);
+    }
+
+    MHashFrozenMap<int> frozen(vector<string>{}, vector<int>{});
+    assert(frozen.empty() && !frozen.get("missing"));
+    MHashFrozenMap<int> frozen_hashed(MHashMap<int>(0));
+    assert(!frozen_hashed.get(""));
+}
+
+// Empty key sets are published like any other, and exceptions thrown on the worker
+// threads reach the caller instead of std::terminate.
+static void test_async_errors() {
+    MHashAsyncMap<int> async;
+    MHashAsyncMap<int>::Reader reader(async.publisher());
+    async.assign({}, {});
+    async.build();
+    assert(!reader.acquire()->get("missing"));
+
+    async.insert("a", 1);
+    future<void> failed = async.build_async([](exception_ptr) { throw runtime_error("callback"); });
+    bool threw = false;
+    try {
+        failed.get();
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    assert(*reader.acquire()->get("a") == 1); // the build itself was published
+    async.insert("b", 2);
+    async.build();
+    assert(*reader.acquire()->get("b") == 2);
+}
+
+static void test_watcher_errors() {
+    const string path = "test_concurrent_keys.txt";
+    FILE* file = fopen(path.c_str(), "w");
+    fputs("\n\n", file);
+    fclose(file);
+    atomic<int> changes{0}, errors{0};
+    MHashAsyncMap<int> async;
+    MHashAsyncMap<int>::Reader reader(async.publisher());
+    {
+        MHashFileWatcher watcher(path, [&](vector<string> keys) {
+            vector<int> values(keys.size());
+            async.assign(std::move(keys), std::move(values));
+            async.build();
+            if (++changes == 1) throw runtime_error("on_change");
+        }, chrono::milliseconds(1), [&](exception_ptr) { ++errors; });
+        while (!errors) this_thread::yield();
+    }
+    remove(path.c_str());
+    assert(changes == 1 && errors == 1);
+    assert(reader.acquire()->empty() && !reader.acquire()->get(""));
+}
+
+// copies throw while fragile_copies is set, e.g. those a fold makes of overflow values
+static bool fragile_copies = false;
+struct Fragile {
+    int value = 0;
+    Fragile(int v = 0) : value(v) {}
+    Fragile(const Fragile& o) : value(o.value) {
+        if (fragile_copies) throw runtime_error("copy");
+    }
+    Fragile& operator=(const Fragile&) = default;
+};
+
+static void test_hybrid_fold_errors() {
+    MHashHybridMap<Fragile> hybrid({}, {}, 1000);
+    {
+        MHashHybridMap<Fragile>::Reader reader(hybrid);
+        assert(!reader.get("missing"));
+        const bool inserted = reader.insert("a", 1) && reader.insert("b", 2);
+        assert(inserted);
+        // the core would see "a", which is already a key
+        bool rejected = false;
+        try {
+            reader.insert(string("a\0" "2", 3), 3);
+        } catch (const invalid_argument&) {
+            rejected = true;
+        }
+        assert(rejected);
+    }
+    fragile_copies = true;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        bool threw = false;
+        try {
+            hybrid.freeze();
+        } catch (const runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    fragile_copies = false;
+    MHashHybridMap<Fragile>::Reader reader(hybrid);
+    assert(reader.get("a")->value == 1 && reader.get("b")->value == 2);
+    const bool duplicate = reader.insert("a", 3);
+    assert(!duplicate);
+    // once copies work again, the next freeze folds the entries into the core
+    hybrid.freeze();
+    assert(reader.get("a")->value == 1 && reader.get("b")->value == 2);
+    const bool inserted = reader.insert("c", 3);
+    assert(inserted && reader.get("c")->value == 3);
+}
+
+// Threads racing to insert the same keys across many folds: exactly one insert per key
+// reports success.
+static void test_hybrid_unique_inserts() {
+    constexpr size_t num_keys = 4000;
+    constexpr unsigned num_threads = 4;
+    MHashHybridMap<int> hybrid({}, {}, 16);
+    vector<atomic<int>> successes(num_keys);
+    vector<thread> threads;
+    for (unsigned t = 0; t < num_threads; ++t)
+        threads.emplace_back([&, t]() {
+            MHashHybridMap<int>::Reader reader(hybrid);
+            for (size_t i = 0; i < num_keys; ++i) {
+                const size_t k = t % 2 ? i : num_keys - 1 - i;
+                const bool inserted = reader.insert("key" + to_string(k), (int)k);
+                if (inserted)
+                    ++successes[k];
+            }
+        });
+    for (auto& t : threads)
+        t.join();
+    MHashHybridMap<int>::Reader reader(hybrid);
+    for (size_t k = 0; k < num_keys; ++k) {
+        assert(successes[k] == 1);
+        assert(*reader.get("key" + to_string(k)) == (int)k);
+    }
+}
+
+int main() {
+    test_empty_maps();
+    test_async_errors();
+    test_watcher_errors();
+    test_hybrid_fold_errors();
+    test_hybrid_unique_inserts();
+    cout << "ok" << endl;
+    return 0;
+}
@@ -0,0 +1,124 @@
+// COMPILE WITH: gcc tests/test_file.c -o tests/test_file -O1 -g
+// mhash_file_open rejects truncated and corrupt files instead of reading past the mapping.
+
+#include "../mhash.h"
+#include "../mhash_str.h"
+#include "../mhash_file.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PATH "test_file.mhash"
+#define PATCHED "test_file_patched.mhash"
+
+static char *read_file(const char *path, size_t *size) {
+    FILE *in = fopen(path, "rb");
+    assert(in);
+    fseek(in, 0, SEEK_END);
+    *size = (size_t)ftell(in);
+    fseek(in, 0, SEEK_SET);
+    char *data = malloc(*size);
+    const size_t got = fread(data, 1, *size, in);
+    assert(got == *size);
+    fclose(in);
+    return data;
+}
+
+static int open_bytes(const char *data, size_t size) {
+    FILE *out = fopen(PATCHED, "wb");
+    assert(out);
+    const size_t written = fwrite(data, 1, size, out);
+    assert(written == size);
+    fclose(out);
+    MHashFile f;
+    int status = mhash_file_open(&f, PATCHED, NULL);
+    mhash_file_close(&f);
+    return status;
+}
+
+int main(void) {
+    const char *keys[] = {"apple", "banana", "cherry", "date", "elderberry"};
+    int values[] = {1, 2, 3, 4, 5};
+    const size_t count = sizeof(keys) / sizeof(keys[0]);
+    MHASH_INDEX_UINT table[64];
+    MHash map;
+    int status = mhash_init(&map, table, 64, (const void **)keys, count, mhash_str_prefix);
+    assert(status == MHASH_OK);
+    status = mhash_file_write(PATH, &map, MHASH_FAMILY_STR_PREFIX, keys, values, sizeof(int));
+    assert(status == MHASH_OK);
+
+    MHashFile f;
+    status = mhash_file_open(&f, PATH, NULL);
+    assert(status == MHASH_OK);
+    for (size_t i = 0; i < count; ++i)
+        assert(*(const int *)mhash_file_get(&f, keys[i]) == values[i]);
+    assert(!mhash_file_get(&f, "fig"));
+    mhash_file_close(&f);
+
+    size_t size;
+    char *data = read_file(PATH, &size);
+    char *patched = malloc(size);
+    MHashFileHeader h;
+    memcpy(&h, data, sizeof(h));
+
+    // truncated files, also when the header claims the truncated size
+    for (size_t length = 0; length < size; ++length) {
+        memcpy(patched, data, size);
+        status = open_bytes(patched, length);
+        assert(status == MHASH_FAILED);
+        if (length >= sizeof(h)) {
+            ((MHashFileHeader *)patched)->file_size = length;
+            status = open_bytes(patched, length);
+            assert(status == MHASH_FAILED);
+        }
+    }
+
+    // corrupt headers
+    MHashFileHeader *p = (MHashFileHeader *)patched;
+    memcpy(patched, data, size);
+    p->shard_bits = 64; // 1 << 64 is undefined, and 1 on x86
+    status = open_bytes(patched, size);
+    assert(status == MHASH_FAILED);
+    memcpy(patched, data, size);
+    p->table_offset = h.values_offset;
+    status = open_bytes(patched, size);
+    assert(status == MHASH_FAILED);
+    memcpy(patched, data, size);
+    p->count = UINT64_MAX / 2;
+    status = open_bytes(patched, size);
+    assert(status == MHASH_FAILED);
+    memcpy(patched, data, size);
+    p->key_pool_offset = h.key_pool_offset + 1;
+    status = open_bytes(patched, size);
+    assert(status == MHASH_FAILED);
+    memcpy(patched, data, size);
+    ((MHashFileShard *)(patched + h.shards_offset))->table_size = h.table_size + 1;
+    status = open_bytes(patched, size);
+    assert(status == MHASH_FAILED);
+    memcpy(patched, data, size);
+    ((MHashFileShard *)(patched + h.shards_offset))->table_size = 0;
+    status = open_bytes(patched, size);
+    assert(status == MHASH_FAILED);
+
+    // corrupt slots and key offsets are bounded at lookup time
+    memcpy(patched, data, size);
+    MHASH_INDEX_UINT *slots = (MHASH_INDEX_UINT *)(patched + h.table_offset);
+    for (size_t i = 0; i < h.table_size; ++i)
+        if (slots[i] != MHASH_EMPTY_SLOT)
+            slots[i] = (MHASH_INDEX_UINT)(slots[i] + 1000);
+    ((uint64_t *)(patched + h.key_offsets_offset))[0] = UINT64_MAX;
+    open_bytes(patched, size);
+    status = mhash_file_open(&f, PATCHED, NULL);
+    assert(status == MHASH_OK);
+    for (size_t i = 0; i < count; ++i)
+        assert(!mhash_file_get(&f, keys[i]));
+    mhash_file_close(&f);
+
+    free(data);
+    free(patched);
+    remove(PATH);
+    remove(PATCHED);
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,42 @@
+// g++ tests/test_shard.cpp -o tests/test_shard -O1 -g -std=c++20 -pthread
+// A failed MHashShardedMap::build leaves the built map and the staged inserts untouched.
+
+#include "../mhash_shard.h"
+#include <cassert>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main() {
+    MHashShardedMap<string> map(4);
+    for (int i = 0; i < 100; ++i)
+        map.insert("key" + to_string(i), "value" + to_string(i));
+    map.build(2);
+    assert(map.size() == 100);
+
+    map.insert("new", "staged");
+    map.insert("key7", "duplicate");
+    bool threw = false;
+    try {
+        map.build(2);
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    assert(map.size() == 100 && !map.get("new"));
+    for (int i = 0; i < 100; ++i)
+        assert(*map.get("key" + to_string(i)) == "value" + to_string(i));
+
+    // the staged inserts are still there: the duplicate fails the next build too
+    threw = false;
+    try {
+        map.build(1);
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    assert(threw && *map.get("key7") == "value7");
+
+    cout << "ok" << endl;
+    return 0;
+}
@@ -0,0 +1,83 @@
+// g++ tests/test_small.cpp -o tests/test_small -O1 -g -std=c++20
+// SmallMHashMap spilling to MHashMap: entries survive a failed tiny build, duplicates
+// are rejected before and after the spill, and many inserts past it stay reachable.
+
+#include "../mhash_cpp.h"
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static bool throws_on_insert(SmallMHashMap<int, 4, 2048>& map, const string& key, int value) {
+    try {
+        map.insert(key, value);
+    } catch (const runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+int main() {
+    // keys sharing 255+ leading bytes make mhash_tiny_build fail while there is room left
+    const string long1 = string(300, 'x') + "1", long2 = string(300, 'x') + "2";
+    SmallMHashMap<int, 4, 2048> map;
+    map.insert("a", 1);
+    map.insert(long1, 2);
+    assert(!map.spilled());
+    map.insert(long2, 3);
+    assert(map.spilled());
+    assert(map.size() == 3);
+    assert(map.get("a") && *map.get("a") == 1);
+    assert(map.get(long1) && *map.get(long1) == 2);
+    assert(map.get(long2) && *map.get(long2) == 3);
+
+    // a duplicate after the spill leaves the map usable
+    assert(throws_on_insert(map, "a", 4));
+    assert(throws_on_insert(map, long2, 5));
+    assert(map.size() == 3);
+    assert(map.get("a") && *map.get("a") == 1);
+    assert(map.get(long1) && *map.get(long1) == 2);
+
+    // and later inserts still build
+    SmallMHashMap<int, 2> full;
+    full.insert("a", 1);
+    full.insert("b", 2);
+    full.insert("c", 3);
+    assert(full.spilled());
+    bool threw = false;
+    try {
+        full.insert("b", 4);
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    full.insert("d", 5);
+    assert(full.size() == 4 && *full.get("b") == 2 && *full.get("d") == 5);
+
+    // inserts well past the spill land in heap maps that are merged as they grow
+    SmallMHashMap<int, 4> many;
+    uint64_t state = 1;
+    vector<string> keys(500);
+    for (string& key : keys) {
+        for (int i = 0; i < 10; ++i) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            key += (char)('a' + (state >> 59) % 26);
+        }
+        many.insert(key, (int)(&key - keys.data()));
+    }
+    assert(many.spilled() && many.size() == keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+        assert(many.get(keys[i]) && *many.get(keys[i]) == (int)i);
+    assert(!many.get("missing"));
+
+    // and before it
+    SmallMHashMap<int, 4, 2048> inline_map;
+    inline_map.insert("a", 1);
+    assert(throws_on_insert(inline_map, "a", 2));
+    assert(!inline_map.spilled() && inline_map.size() == 1 && *inline_map.get("a") == 1);
+
+    cout << "ok" << endl;
+    return 0;
+}
@@ -0,0 +1,65 @@
+// g++ tests/test_static.cpp -o tests/test_static -O1 -g -std=c++20
+// mhash_static_map builds within the compiler's default constexpr limits and finds every
+// key; the static_asserts fail the build when it does not.
+
+#include "../mhash_static.h"
+#include <cassert>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+enum class Method { GET, PUT, POST, DELETE, HEAD, OPTIONS, PATCH };
+
+static constexpr auto methods = mhash_static_map([] {
+    return array<string_view, 7>{"GET", "PUT", "POST", "DELETE", "HEAD", "OPTIONS", "PATCH"};
+});
+static_assert(methods.find("POST") == 2 && methods.find("PATCH") == 6);
+static_assert(methods.find("") == -1 && methods.find("GETS") == -1 && methods.find("get") == -1);
+static_assert(methods.to_enum<Method>("DELETE") == Method::DELETE);
+static_assert(!methods.to_enum<Method>("TRACE"));
+static_assert(methods.key(4) == "HEAD");
+
+// tests/keywords.txt
+static constexpr auto keywords = mhash_static_map([] {
+    return array<string_view, 147>{
+        "ABORT", "ACTION", "ADD", "AFTER", "ALL", "ALTER", "ALWAYS", "ANALYZE", "AND", "AS", "ASC",
+        "ATTACH", "AUTOINCREMENT", "BEFORE", "BEGIN", "BETWEEN", "BY", "CASCADE", "CASE", "CAST",
+        "CHECK", "COLLATE", "COLUMN", "COMMIT", "CONFLICT", "CONSTRAINT", "CREATE", "CROSS",
+        "CURRENT", "CURRENT_DATE", "CURRENT_TIME", "CURRENT_TIMESTAMP", "DATABASE", "DEFAULT",
+        "DEFERRABLE", "DEFERRED", "DELETE", "DESC", "DETACH", "DISTINCT", "DO", "DROP", "EACH",
+        "ELSE", "END", "ESCAPE", "EXCEPT", "EXCLUDE", "EXCLUSIVE", "EXISTS", "EXPLAIN", "FAIL",
+        "FILTER", "FIRST", "FOLLOWING", "FOR", "FOREIGN", "FROM", "FULL", "GENERATED", "GLOB",
+        "GROUP", "GROUPS", "HAVING", "IF", "IGNORE", "IMMEDIATE", "IN", "INDEX", "INDEXED",
+        "INITIALLY", "INNER", "INSERT", "INSTEAD", "INTERSECT", "INTO", "IS", "ISNULL", "JOIN",
+        "KEY", "LAST", "LEFT", "LIKE", "LIMIT", "MATCH", "MATERIALIZED", "NATURAL", "NO", "NOT",
+        "NOTHING", "NOTNULL", "NULL", "NULLS", "OF", "OFFSET", "ON", "OR", "ORDER", "OTHERS",
+        "OUTER", "OVER", "PARTITION", "PLAN", "PRAGMA", "PRECEDING", "PRIMARY", "QUERY", "RAISE",
+        "RANGE", "RECURSIVE", "REFERENCES", "REGEXP", "REINDEX", "RELEASE", "RENAME", "REPLACE",
+        "RESTRICT", "RETURNING", "RIGHT", "ROLLBACK", "ROW", "ROWS", "SAVEPOINT", "SELECT", "SET",
+        "TABLE", "TEMP", "TEMPORARY", "THEN", "TIES", "TO", "TRANSACTION", "TRIGGER", "UNBOUNDED",
+        "UNION", "UNIQUE", "UPDATE", "USING", "VACUUM", "VALUES", "VIEW", "VIRTUAL", "WHEN",
+        "WHERE", "WINDOW", "WITH", "WITHOUT"};
+});
+
+static constexpr bool finds_all_keywords() {
+    for (size_t i = 0; i < keywords.size(); ++i)
+        if (keywords.find(keywords.key(i)) != (int)i)
+            return false;
+    return true;
+}
+static_assert(finds_all_keywords());
+static_assert(keywords.find("SELECTS") == -1 && keywords.find("select") == -1);
+
+int main() {
+    for (size_t i = 0; i < keywords.size(); ++i) {
+        const string key(keywords.key(i));
+        assert(keywords.find(key.c_str()) == (int)i);
+        assert(!keywords.contains(key + "_"));
+    }
+    assert(methods.find("OPTIONS") == 5);
+    cout << keywords.size() << " keywords, " << keywords.table_size() << " slots, "
+         << keywords.num_hashes() << " hashes" << endl;
+    cout << "ok" << endl;
+    return 0;
+}